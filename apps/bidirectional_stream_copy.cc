@@ -12,12 +12,13 @@ using namespace std;
 void bidirectional_stream_copy( Socket& socket, string_view peer_name )
 {
   constexpr size_t buffer_size = 1048576;
+  constexpr size_t max_write_views = 64;
 
   EventLoop _eventloop {};
   FileDescriptor _input { STDIN_FILENO };
   FileDescriptor _output { STDOUT_FILENO };
-  ByteStream _outbound { buffer_size };
-  ByteStream _inbound { buffer_size };
+  ByteStream _outbound { buffer_size, ByteStream::Backend::Ring };
+  ByteStream _inbound { buffer_size, ByteStream::Backend::Ring };
   bool _outbound_shutdown { false };
   bool _inbound_shutdown { false };
 
@@ -31,10 +32,8 @@ void bidirectional_stream_copy( Socket& socket, string_view peer_name )
     _input,
     Direction::In,
     [&] {
-      string data;
-      data.resize( _outbound.writer().available_capacity() );
-      _input.read( data );
-      _outbound.writer().push( move( data ) );
+      Writer& writer = _outbound.writer();
+      writer.commit( _input.read( writer.reserve( writer.available_capacity() ) ) );
       if ( _input.eof() ) {
         _outbound.writer().close();
       }
@@ -57,7 +56,7 @@ void bidirectional_stream_copy( Socket& socket, string_view peer_name )
     Direction::Out,
     [&] {
       if ( _outbound.reader().bytes_buffered() ) {
-        _outbound.reader().pop( socket.write( _outbound.reader().peek() ) );
+        _outbound.reader().pop( socket.write( _outbound.reader().peek_views( max_write_views ) ) );
       }
       if ( _outbound.reader().is_finished() ) {
         socket.shutdown( SHUT_WR );
@@ -81,10 +80,8 @@ void bidirectional_stream_copy( Socket& socket, string_view peer_name )
     socket,
     Direction::In,
     [&] {
-      string data;
-      data.resize( _inbound.writer().available_capacity() );
-      socket.read( data );
-      _inbound.writer().push( move( data ) );
+      Writer& writer = _inbound.writer();
+      writer.commit( socket.read( writer.reserve( writer.available_capacity() ) ) );
       if ( socket.eof() ) {
         _inbound.writer().close();
       }
@@ -107,7 +104,7 @@ void bidirectional_stream_copy( Socket& socket, string_view peer_name )
     Direction::Out,
     [&] {
       if ( _inbound.reader().bytes_buffered() ) {
-        _inbound.reader().pop( _output.write( _inbound.reader().peek() ) );
+        _inbound.reader().pop( _output.write( _inbound.reader().peek_views( max_write_views ) ) );
       }
       if ( _inbound.reader().is_finished() ) {
         _output.close();
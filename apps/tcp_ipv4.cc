@@ -11,6 +11,7 @@
 #include <span>
 #include <string>
 #include <tuple>
+#include <utility>
 
 using namespace std;
 
@@ -30,8 +31,11 @@ void show_usage( const char* argv0, const char* msg )
        << "   -a <addr>       Set source address (client mode only)           " << LOCAL_ADDRESS_DFLT << "\n"
        << "   -s <port>       Set source port (client mode only)              (random)\n\n"
 
-       << "   -w <winsz>      Use a window of <winsz> bytes                   " << TCPConfig::MAX_PAYLOAD_SIZE
-       << "\n\n"
+       << "   -w <winsz>      Use a window of <winsz> bytes                   " << TCPConfig::DEFAULT_CAPACITY
+       << "\n"
+       << "   -W <sndsz>      Buffer (and keep in flight) at most <sndsz>     " << TCPConfig::DEFAULT_CAPACITY
+       << "\n"
+       << "                   bytes of outbound data\n\n"
 
        << "   -t <tmout>      Set rt_timeout to tmout                         " << TCPConfig::TIMEOUT_DFLT << "\n\n"
 
@@ -60,6 +64,11 @@ tuple<TCPConfig, FdAdapterConfig, bool, const char*> get_config( const span<char
 {
   TCPConfig c_fsm {};
   c_fsm.isn = Wrap32 { random_device()() };
+  // the peer is an ordinary TCP on the Internet: recover from loss, and use the options, as it does
+  c_fsm.fast_retransmit = true;
+  c_fsm.sack = true;
+  c_fsm.window_scaling = true;
+  c_fsm.timestamps = true;
 
   FdAdapterConfig c_filt {};
   const char* tundev = nullptr;
@@ -91,6 +100,11 @@ tuple<TCPConfig, FdAdapterConfig, bool, const char*> get_config( const span<char
       c_fsm.recv_capacity = strtol( args[curr + 1], nullptr, 0 );
       curr += 2;
 
+    } else if ( strncmp( "-W", args[curr], 3 ) == 0 ) {
+      check_argc( args, curr, "ERROR: -W requires one argument." );
+      c_fsm.send_capacity = strtol( args[curr + 1], nullptr, 0 );
+      curr += 2;
+
     } else if ( strncmp( "-t", args[curr], 3 ) == 0 ) {
       check_argc( args, curr, "ERROR: -t requires one argument." );
       c_fsm.rt_timeout = strtol( args[curr + 1], nullptr, 0 );
@@ -158,8 +172,10 @@ int main( int argc, char** argv )
     }
 
     auto [c_fsm, c_filt, listen, tun_dev_name] = get_config( args );
-    LossyTCPOverIPv4MinnowSocket tcp_socket( LossyFdAdapter<TCPOverIPv4OverTunFdAdapter>(
-      TCPOverIPv4OverTunFdAdapter( TunFD( tun_dev_name == nullptr ? TUN_DFLT : tun_dev_name ) ) ) );
+    TunFD tun { tun_dev_name == nullptr ? TUN_DFLT : tun_dev_name };
+    c_fsm.mss = TCPConfig::mss_for_mtu( tun.mtu() );
+    LossyTCPOverIPv4MinnowSocket tcp_socket(
+      LossyFdAdapter<TCPOverIPv4OverTunFdAdapter>( TCPOverIPv4OverTunFdAdapter( std::move( tun ) ) ) );
 
     if ( listen ) {
       tcp_socket.listen_and_accept( c_fsm, c_filt );
@@ -23,6 +23,14 @@ ttest(byte_stream_one_write)
 ttest(byte_stream_two_writes)
 ttest(byte_stream_many_writes)
 ttest(byte_stream_stress_test)
+ttest(byte_stream_ring)
+ttest(byte_stream_peek_views)
+ttest(byte_stream_reserve)
+ttest(byte_stream_spsc)
+ttest(byte_stream_pool)
+ttest(byte_stream_splice)
+ttest(byte_stream_coroutine)
+ttest(byte_stream_coalesce)
 
 ttest(reassembler_single)
 ttest(reassembler_cap)
@@ -31,12 +39,17 @@ ttest(reassembler_dup)
 ttest(reassembler_holes)
 ttest(reassembler_overlapping)
 ttest(reassembler_win)
+ttest(reassembler_window)
+ttest(reassembler_arena)
+ttest(reassembler_batch)
+ttest(reassembler_budget)
 
 ttest(wrapping_integers_cmp)
 ttest(wrapping_integers_wrap)
 ttest(wrapping_integers_unwrap)
 ttest(wrapping_integers_roundtrip)
 ttest(wrapping_integers_extra)
+ttest(wrapping_integers_seqspace)
 
 ttest(recv_connect)
 ttest(recv_transmit)
@@ -45,6 +58,9 @@ ttest(recv_reorder)
 ttest(recv_reorder_more)
 ttest(recv_close)
 ttest(recv_special)
+ttest(recv_sack)
+ttest(recv_window_scale)
+ttest(recv_timestamps)
 
 ttest(send_connect)
 ttest(send_transmit)
@@ -53,6 +69,14 @@ ttest(send_window)
 ttest(send_ack)
 ttest(send_close)
 ttest(send_extra)
+ttest(send_queue)
+ttest(send_rtt)
+ttest(send_fast_retx)
+ttest(send_congestion)
+ttest(send_sack)
+ttest(send_window_scale)
+ttest(send_timestamps)
+ttest(send_mss)
 
 ttest(net_interface)
 
@@ -76,6 +100,13 @@ add_custom_target (check6 COMMAND ${CMAKE_CTEST_COMMAND} --output-on-failure --s
 
 add_custom_target (speed COMMAND ${CMAKE_CTEST_COMMAND} --output-on-failure --timeout 12 -R '_speed_test')
 
+add_custom_target (benchmark
+  COMMAND byte_stream_benchmark --format=json --output=${CMAKE_BINARY_DIR}/byte_stream_benchmark.json
+  COMMAND byte_stream_benchmark --format=csv --output=${CMAKE_BINARY_DIR}/byte_stream_benchmark.csv
+  COMMAND reassembler_benchmark --format=json --output=${CMAKE_BINARY_DIR}/reassembler_benchmark.json
+  COMMAND reassembler_benchmark --format=csv --output=${CMAKE_BINARY_DIR}/reassembler_benchmark.csv
+  DEPENDS byte_stream_benchmark reassembler_benchmark)
+
 set(compile_name_opt "compile with optimization")
 add_test(NAME ${compile_name_opt}
   COMMAND "${CMAKE_COMMAND}" --build "${CMAKE_BINARY_DIR}" -t speed_testing)
@@ -0,0 +1,34 @@
+#include "buffer_pool.hh"
+
+#include <utility>
+
+using namespace std;
+
+string BufferPool::acquire( size_t len )
+{
+  auto* free_list = len <= small_chunk ? &free_small_ : len <= large_chunk ? &free_large_ : nullptr;
+
+  if ( free_list and not free_list->empty() ) {
+    string buffer = move( free_list->back() );
+    free_list->pop_back();
+    ++hits_;
+    return buffer;
+  }
+
+  ++misses_;
+  string buffer;
+  buffer.reserve( free_list == &free_small_ ? small_chunk : free_list == &free_large_ ? large_chunk : len );
+  return buffer;
+}
+
+void BufferPool::release( string&& buffer )
+{
+  const size_t capacity = buffer.capacity();
+  if ( capacity >= large_chunk and capacity < 2 * large_chunk and free_large_.size() < max_free_large_ ) {
+    buffer.clear();
+    free_large_.push_back( move( buffer ) );
+  } else if ( capacity >= small_chunk and capacity < 2 * small_chunk and free_small_.size() < max_free_small_ ) {
+    buffer.clear();
+    free_small_.push_back( move( buffer ) );
+  }
+}
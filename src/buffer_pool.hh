@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+ * A free list of std::string buffers in two fixed size classes, shared by the ByteStreams,
+ * Reassembler and TCPSender of one connection (it is not thread-safe).
+ *
+ * acquire() hands out an empty string with at least the requested capacity, reusing a
+ * released buffer of the matching class when one is available (a "hit") and allocating
+ * a new buffer of the class size otherwise (a "miss"). Requests larger than the largest
+ * class are always misses and are allocated to fit. release() takes a buffer back if its
+ * capacity is within a factor of two of a class size and that class's free list is not full;
+ * anything else is simply freed.
+ */
+class BufferPool
+{
+public:
+  static constexpr size_t small_chunk = 2048;  // e.g. one segment payload
+  static constexpr size_t large_chunk = 65536; // e.g. a bulk read from a socket
+
+  explicit BufferPool( size_t max_free_small = 128, size_t max_free_large = 16 )
+    : max_free_small_( max_free_small ), max_free_large_( max_free_large )
+  {}
+
+  std::string acquire( size_t len );
+  void release( std::string&& buffer );
+
+  uint64_t hits() const { return hits_; }     // acquire() calls served from a free list
+  uint64_t misses() const { return misses_; } // acquire() calls that had to allocate
+  size_t free_buffers() const { return free_small_.size() + free_large_.size(); }
+
+private:
+  size_t max_free_small_;
+  size_t max_free_large_;
+  std::vector<std::string> free_small_ {};
+  std::vector<std::string> free_large_ {};
+  uint64_t hits_ { 0 };
+  uint64_t misses_ { 0 };
+};
@@ -1,12 +1,21 @@
 #include "byte_stream.hh"
+#include "eventloop.hh"
+
+#include <algorithm>
 #include <cstdint>
+#include <cstring>
+#include <stdexcept>
 #include <string>
 #include <type_traits>
 #include <utility>
 
 using namespace std;
 
-ByteStream::ByteStream( uint64_t capacity ) : capacity_( capacity ) {}
+ByteStream::ByteStream( uint64_t capacity, Backend backend )
+  : ring_( backend == Backend::Ring ? MirroredBuffer { capacity } : MirroredBuffer {} )
+  , capacity_( capacity )
+  , backend_( backend )
+{}
 
 bool Writer::is_closed() const
 {
@@ -15,27 +24,108 @@ bool Writer::is_closed() const
 
 void Writer::push( string data )
 {
+  // push 会写到预留空间所在的位置，之前没 commit 的预留就作废了，免得 commit 再把它发布出去
+  reserved_ = 0;
   if ( available_capacity() == 0 || data.empty() ) {
     return;
   }
   uint64_t writeDatalen = min( data.length(), available_capacity() );
-  data = data.substr( 0, writeDatalen );
+  if ( backend_ == Backend::Ring ) {
+    // 镜像映射保证从任意起点写 capacity 以内的数据都是连续的，不需要分两段拷贝
+    memcpy( ring_.data() + ( ring_head_ + bufferBytes ) % ring_.size(), data.data(), writeDatalen );
+  } else if ( writeDatalen < coalesce_size_ && !data_queue_.empty()
+              && data_queue_.back().capacity() - data_queue_.back().size() >= writeDatalen ) {
+    // 小块写入：直接拷贝到队尾块的空余容量里，不再单独占一个队列节点
+    data_queue_.back().append( data, 0, writeDatalen );
+    recycle( move( data ) );
+  } else {
+    const uint64_t chunk_size = min( max<uint64_t>( BufferPool::small_chunk, coalesce_size_ ), capacity_ );
+    if ( writeDatalen < coalesce_size_ && data.capacity() < chunk_size ) {
+      // 小块但队尾放不下：换成一个够大的块再入队，后面的小块就可以接着往里追加。
+      // 优先用 recycle 留下的块，这样读写交替时整个过程不需要再分配内存
+      string chunk;
+      if ( reserved_ == 0 && staging_.capacity() >= chunk_size ) {
+        chunk = move( staging_ );
+        staging_ = string {};
+      } else if ( pool_ ) {
+        chunk = pool_->acquire( chunk_size );
+      }
+      chunk.reserve( chunk_size );
+      chunk.assign( data, 0, writeDatalen );
+      data = move( chunk );
+    }
+    data.resize( writeDatalen ); // 截断而不是 substr，避免再拷贝一次
+    enqueue( move( data ) );
+  }
   pushedBytes = pushedBytes + writeDatalen;
   bufferBytes = bufferBytes + writeDatalen;
-  // load data into queue
-  data_queue_.emplace_back( move( data ) );
-  // add a string view which we will use in the reader part
-  // view_queue_.emplace_back( data_queue_.back() );
-  // 最开始viewData没有初始化(为空)，这个时候需要将它归位到首位字节
-  if ( viewData.empty() ) {
-    viewData = data_queue_.front();
+  notify();
+}
+
+span<char> Writer::reserve( uint64_t len )
+{
+  reserved_ = min( len, available_capacity() );
+  if ( reserved_ == 0 ) {
+    return {};
+  }
+  if ( backend_ == Backend::Ring ) {
+    return { ring_.data() + ( ring_head_ + bufferBytes ) % ring_.size(), reserved_ };
+  }
+  // 分块模式下先写到 staging_ 里，commit 时整块放进队列
+  if ( pool_ && staging_.capacity() < reserved_ ) {
+    pool_->release( move( staging_ ) );
+    staging_ = pool_->acquire( reserved_ );
   }
-  return;
+  // 只在不够大的时候才扩大：每次都 resize 会把整段预留空间清零，commit 时再截断到实际写入的长度
+  if ( staging_.size() < reserved_ ) {
+    staging_.resize( reserved_ );
+  }
+  return { staging_.data(), reserved_ };
+}
+
+void Writer::commit( uint64_t len )
+{
+  if ( len > reserved_ ) {
+    throw runtime_error( "Writer::commit() called with more bytes than were reserved" );
+  }
+  reserved_ = 0;
+  if ( len == 0 ) {
+    return;
+  }
+  if ( backend_ == Backend::Chunked ) {
+    if ( len * 2 < staging_.capacity() ) {
+      // 只写了一小部分：拷贝成合适大小的块，staging_ 留着下次复用，避免一个小块占着整块大内存
+      string chunk = pool_ ? pool_->acquire( len ) : string {};
+      chunk.assign( staging_.data(), len );
+      enqueue( move( chunk ) );
+    } else {
+      staging_.resize( len );
+      enqueue( move( staging_ ) );
+      staging_ = string {};
+    }
+  }
+  pushedBytes += len;
+  bufferBytes += len;
+  notify();
+}
+
+void Writer::grow_capacity( uint64_t capacity )
+{
+  if ( capacity <= capacity_ ) {
+    return;
+  }
+  // Ring 的缓冲区在构造时就映射好了，大小没法改
+  if ( backend_ == Backend::Ring ) {
+    throw runtime_error( "Writer::grow_capacity() called on a Ring stream" );
+  }
+  capacity_ = capacity;
+  notify();
 }
 
 void Writer::close()
 {
   is_closed_var = true;
+  notify();
 }
 
 uint64_t Writer::available_capacity() const
@@ -66,46 +156,138 @@ uint64_t Reader::bytes_popped() const
 string_view Reader::peek() const
 {
   // Peek at the next bytes in the buffer
-  if ( viewData.empty() ) {
+  if ( bufferBytes == 0 ) {
+    return {};
+  }
+  if ( backend_ == Backend::Ring ) {
+    return { ring_.data() + ring_head_, bufferBytes };
+  }
+  return string_view { data_queue_.front() }.substr( front_offset_ );
+}
+
+string_view Reader::peek_at( uint64_t offset ) const
+{
+  if ( offset >= bufferBytes ) {
     return {};
   }
-  return viewData;
+  if ( backend_ == Backend::Ring ) {
+    return { ring_.data() + ring_head_ + offset, bufferBytes - offset };
+  }
+  // 各块的起点递增：二分找到最后一个起点不超过这个字节的块
+  const uint64_t index = popedBytes + offset;
+  const auto it = upper_bound( chunk_starts_.begin(), chunk_starts_.end(), index ) - 1;
+  return string_view { data_queue_[it - chunk_starts_.begin()] }.substr( index - *it );
+}
+
+vector<string_view> Reader::peek_views( size_t max_views ) const
+{
+  vector<string_view> views;
+  if ( bufferBytes == 0 || max_views == 0 ) {
+    return views;
+  }
+  if ( backend_ == Backend::Ring ) {
+    views.push_back( peek() );
+    return views;
+  }
+  views.reserve( min( max_views, data_queue_.size() ) );
+  views.push_back( peek() );
+  for ( auto it = data_queue_.begin() + 1; it != data_queue_.end() && views.size() < max_views; ++it ) {
+    views.emplace_back( *it );
+  }
+  return views;
 }
 
 void Reader::pop( uint64_t len )
 {
   // Remove `len` bytes from the buffer
   auto n = min( len, bufferBytes );
+  if ( n == 0 ) {
+    return;
+  }
+  bufferBytes -= n;
+  popedBytes += n;
+  notify(); // 只是把等待的协程交给 EventLoop，不会在这里恢复它们，所以放在前面也没关系
+  if ( backend_ == Backend::Ring ) {
+    // 缓冲区空了就把起点归零，让后续数据尽量从头开始
+    ring_head_ = bufferBytes == 0 ? 0 : ( ring_head_ + n ) % ring_.size();
+    return;
+  }
   while ( n > 0 ) {
-    auto sz = viewData.length();
-    if ( n <= sz ) {
-      viewData.remove_prefix( n );
-      bufferBytes -= n;
-      popedBytes += n;
-      // 检测是否viewData空了
-      if ( viewData.empty() ) {
-        data_queue_.pop_front();
-        if ( data_queue_.empty() ) {
-          viewData = ""; // 将viewData置空
-        } else {
-          viewData = data_queue_.front();
-        }
-        // viewData = data_queue_.empty() ? "" : data_queue_.front();
-      }
+    const uint64_t remaining = data_queue_.front().size() - front_offset_;
+    if ( n < remaining ) {
+      front_offset_ += n;
       return;
     }
-    // view_queue_.pop_front();
-    data_queue_.pop_front();
-    // viewData = data_queue_.empty() ? "" : data_queue_.front();
-    if ( data_queue_.empty() ) {
-      viewData = ""; // 将viewData置空
+    // 当前块被完全读完，丢弃它并转到下一个块，它的内存交给 recycle 复用
+    recycle( move( data_queue_.front() ) );
+    dequeue();
+    front_offset_ = 0;
+    n -= remaining;
+  }
+}
+
+void ByteStream::enqueue( string&& chunk )
+{
+  chunk_starts_.push_back( pushedBytes );
+  data_queue_.emplace_back( move( chunk ) );
+}
+
+void ByteStream::dequeue()
+{
+  chunk_starts_.pop_front();
+  data_queue_.pop_front();
+}
+
+void ByteStream::recycle( string&& chunk )
+{
+  if ( pool_ ) {
+    pool_->release( move( chunk ) );
+  } else if ( reserved_ == 0 && chunk.capacity() > staging_.capacity() ) {
+    // 没有 pool 的时候，至少把它留给下一次 reserve 用
+    staging_ = move( chunk );
+  }
+}
+
+uint64_t splice( Reader& from, Writer& to, uint64_t len )
+{
+  uint64_t n = min( { len, from.bytes_buffered(), to.available_capacity() } );
+  const uint64_t total = n;
+  to.reserved_ = 0;
+  while ( n > 0 ) {
+    if ( from.backend_ == ByteStream::Backend::Chunked && to.backend_ == ByteStream::Backend::Chunked ) {
+      string& front = from.data_queue_.front();
+      const uint64_t remaining = front.size() - from.front_offset_;
+      if ( remaining <= n ) {
+        // 整块交给 to，不拷贝；已经被读掉一部分的块只需要在原地把剩下的挪到开头
+        front.erase( 0, from.front_offset_ );
+        to.enqueue( move( front ) );
+        from.dequeue();
+        from.front_offset_ = 0;
+        from.bufferBytes -= remaining;
+        from.popedBytes += remaining;
+        to.bufferBytes += remaining;
+        to.pushedBytes += remaining;
+        n -= remaining;
+        continue;
+      }
+    }
+    // 被 len 切开的块，或者有一边是 Ring 后端：只能拷贝
+    const string_view view = from.peek().substr( 0, n );
+    if ( to.backend_ == ByteStream::Backend::Ring ) {
+      const auto space = to.reserve( view.size() );
+      memcpy( space.data(), view.data(), view.size() );
+      to.commit( view.size() );
     } else {
-      viewData = data_queue_.front();
+      string chunk = to.pool_ ? to.pool_->acquire( view.size() ) : string {};
+      chunk.assign( view );
+      to.push( move( chunk ) );
     }
-    n -= sz;
-    bufferBytes -= sz;
-    popedBytes += sz;
+    from.pop( view.size() );
+    n -= view.size();
   }
+  from.notify();
+  to.notify();
+  return total;
 }
 
 uint64_t Reader::bytes_buffered() const
@@ -113,3 +295,90 @@ uint64_t Reader::bytes_buffered() const
   // Number of bytes currently buffered (pushed and not popped)
   return bufferBytes;
 }
+
+bool ByteStream::ready( const Awaiter& awaiter ) const
+{
+  if ( error_ ) {
+    return true;
+  }
+  switch ( awaiter.until_ ) {
+    case Awaiter::Until::Readable:
+      return bufferBytes >= awaiter.n_ || is_closed_var;
+    case Awaiter::Until::Writable:
+      return capacity_ - bufferBytes >= min( awaiter.n_, capacity_ );
+    case Awaiter::Until::Finished:
+      return is_closed_var && bufferBytes == 0;
+  }
+  return true;
+}
+
+void ByteStream::wake_waiters()
+{
+  auto& awaiters = waiters_.awaiters_;
+  // 条件满足的交给 EventLoop 排队恢复，其余的留在表里（保持原来的顺序）
+  auto keep = awaiters.begin();
+  for ( auto* awaiter : awaiters ) {
+    if ( ready( *awaiter ) ) {
+      awaiter->list_ = nullptr;
+      awaiter->scheduled_ = true;
+      EventLoop::schedule( awaiter->handle_ );
+    } else {
+      *keep++ = awaiter;
+    }
+  }
+  awaiters.erase( keep, awaiters.end() );
+}
+
+void ByteStream::Awaiter::await_suspend( coroutine_handle<> handle )
+{
+  handle_ = handle;
+  stream_->waiters_.add( this );
+}
+
+ByteStream::Awaiter::~Awaiter()
+{
+  if ( list_ ) {
+    list_->remove( this );
+  } else if ( scheduled_ ) {
+    EventLoop::unschedule( handle_ );
+  }
+}
+
+void ByteStream::WaiterList::add( Awaiter* awaiter )
+{
+  awaiter->list_ = this;
+  awaiters_.push_back( awaiter );
+}
+
+void ByteStream::WaiterList::remove( Awaiter* awaiter )
+{
+  awaiter->list_ = nullptr;
+  erase( awaiters_, awaiter );
+}
+
+ByteStream::WaiterList::WaiterList( WaiterList&& other ) noexcept : awaiters_( move( other.awaiters_ ) )
+{
+  other.awaiters_.clear();
+  for ( auto* awaiter : awaiters_ ) {
+    awaiter->list_ = this;
+  }
+}
+
+ByteStream::WaiterList& ByteStream::WaiterList::operator=( WaiterList&& other ) noexcept
+{
+  if ( this != &other ) {
+    for ( auto* awaiter : other.awaiters_ ) {
+      add( awaiter );
+    }
+    other.awaiters_.clear();
+  }
+  return *this;
+}
+
+ByteStream::WaiterList::~WaiterList()
+{
+  // 流先于等待它的协程销毁：这些协程再也不会被唤醒，只需要断开它们指向本表的指针
+  for ( auto* awaiter : awaiters_ ) {
+    awaiter->list_ = nullptr;
+  }
+}
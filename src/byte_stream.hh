@@ -1,9 +1,16 @@
 #pragma once
 
+#include "buffer_pool.hh"
+#include "mirrored_buffer.hh"
+
+#include <coroutine>
 #include <cstdint>
 #include <deque>
+#include <memory>
+#include <span>
 #include <string>
 #include <string_view>
+#include <vector>
 
 class Reader;
 class Writer;
@@ -11,8 +18,18 @@ class Writer;
 class ByteStream
 {
 public:
-  explicit ByteStream(
-    uint64_t capacity ); // explicit 限制了只能通过显式调用构造函数来创建对象，而不能通过隐式转换来创建对象
+  // How the buffered bytes are stored.
+  //   Chunked: a queue of the pushed strings; push() takes ownership of each string without copying it
+  //            (small pushes are copied into the last chunk instead, see set_coalesce_size()).
+  //   Ring: one buffer of `capacity` bytes, mapped twice so that peek() always returns every buffered byte.
+  enum class Backend
+  {
+    Chunked,
+    Ring
+  };
+
+  // explicit 限制了只能通过显式调用构造函数来创建对象，而不能通过隐式转换来创建对象
+  explicit ByteStream( uint64_t capacity, Backend backend = Backend::Chunked );
 
   // Helper functions (provided) to access the ByteStream's Reader and Writer interfaces
   Reader& reader();
@@ -20,10 +37,50 @@ public:
   Writer& writer();
   const Writer& writer() const;
 
-  void set_error() { error_ = true; };       // Signal that the stream suffered an error.
+  void set_error()                           // Signal that the stream suffered an error.
+  {
+    error_ = true;
+    notify();
+  };
   bool has_error() const { return error_; }; // Has the stream had an error?
+  Backend backend() const { return backend_; }   // Which storage backend does the stream use?
+
+  // Optional pool that popped chunks are returned to (and that the staging chunk is drawn from)
+  void set_buffer_pool( std::shared_ptr<BufferPool> pool ) { pool_ = std::move( pool ); }
+  const std::shared_ptr<BufferPool>& buffer_pool() const { return pool_; }
+
+  // Chunked backend: a push() of fewer than `size` bytes is appended to the last chunk when that
+  // chunk has room, instead of being queued as a chunk of its own. Off (0) by default, since a small
+  // push then starts a chunk of BufferPool::small_chunk bytes; small_write_coalesce_size suits a
+  // stream written a few dozen bytes at a time (see byte_stream_speed_test).
+  static constexpr uint64_t small_write_coalesce_size = 256;
+  void set_coalesce_size( uint64_t size ) { coalesce_size_ = size; }
+  uint64_t coalesce_size() const { return coalesce_size_; }
+
+  class Awaiter; // returned by Reader::readable(), Writer::writable() and Reader::finished()
 
 protected:
+  // The coroutines suspended on this stream. A copy of a stream starts with no waiters; a moved-to
+  // stream takes them over. Destroying the list detaches any waiter that is still suspended.
+  class WaiterList
+  {
+  public:
+    WaiterList() = default;
+    WaiterList( const WaiterList& /* other */ ) : awaiters_() {}
+    WaiterList& operator=( const WaiterList& /* other */ ) { return *this; }
+    WaiterList( WaiterList&& other ) noexcept;
+    WaiterList& operator=( WaiterList&& other ) noexcept;
+    ~WaiterList();
+
+    bool empty() const { return awaiters_.empty(); }
+    void add( Awaiter* awaiter );
+    void remove( Awaiter* awaiter );
+
+  private:
+    friend class ByteStream;
+    std::vector<Awaiter*> awaiters_ {};
+  };
+
   // Please add any additional state to the ByteStream here, and not to the Writer and Reader interfaces.
   // using static to share the number of write and receive
   uint64_t pushedBytes { 0 };
@@ -31,18 +88,95 @@ protected:
   uint64_t bufferBytes { 0 };
   bool is_closed_var { false };
   std::deque<std::string> data_queue_ {};
-  // std::deque<std::string_view> view_queue_{};
-  std::string_view viewData {};
+  std::deque<uint64_t> chunk_starts_ {}; // stream index of each chunk's first byte, so peek_at() can bisect
+  uint64_t front_offset_ { 0 };          // bytes of data_queue_.front() that have already been popped
+  MirroredBuffer ring_ {};      // Ring backend: storage for the buffered bytes
+  uint64_t ring_head_ { 0 };    // Ring backend: offset of the first buffered byte in ring_
+  std::string staging_ {};      // Chunked backend: chunk handed out by reserve(), queued by commit()
+  uint64_t reserved_ { 0 };     // bytes handed out by the last reserve() and not yet committed
+  std::shared_ptr<BufferPool> pool_ {};
+  uint64_t coalesce_size_ { 0 };
+
+  WaiterList waiters_ {};
+
+  void enqueue( std::string&& chunk ); // queue a chunk that starts at bytes_pushed()
+  void dequeue();                      // drop the front chunk (its memory is not recycled)
+  void recycle( std::string&& chunk ); // reuse the memory of a fully popped chunk
+  void notify()                        // schedule the waiters whose condition now holds
+  {
+    if ( not waiters_.empty() ) {
+      wake_waiters();
+    }
+  }
+  void wake_waiters();
+  bool ready( const Awaiter& awaiter ) const;
+  friend uint64_t splice( Reader& from, Writer& to, uint64_t len );
   uint64_t capacity_;
+  Backend backend_;
   bool error_ {};
 };
 
+/*
+ * Awaiter: lets a C++20 coroutine (e.g. a Task) suspend until a stream is ready, as in
+ *
+ *   co_await inbound.reader().readable( 1 );
+ *
+ * If the condition already holds, co_await does not suspend. Otherwise the coroutine is parked
+ * on the stream, and the push/commit/pop/close/set_error that makes the condition true hands it
+ * to EventLoop::schedule(); the EventLoop resumes it from wait_next_event(). Nothing is polled
+ * while it waits. An error on the stream also resumes every waiter, so check has_error() after.
+ */
+class ByteStream::Awaiter
+{
+public:
+  enum class Until
+  {
+    Readable, // at least `n` bytes buffered (or the writer closed, so no more will come)
+    Writable, // at least `n` bytes of available capacity (`n` is limited to the capacity)
+    Finished  // closed and fully popped
+  };
+
+  Awaiter( ByteStream& stream, Until until, uint64_t n ) : stream_( &stream ), until_( until ), n_( n ) {}
+  Awaiter( const Awaiter& other ) = delete;
+  Awaiter& operator=( const Awaiter& other ) = delete;
+  Awaiter( Awaiter&& other ) = delete;
+  Awaiter& operator=( Awaiter&& other ) = delete;
+  ~Awaiter(); // a coroutine destroyed while waiting is forgotten by the stream and the EventLoop
+
+  bool await_ready() const { return stream_->ready( *this ); }
+  void await_suspend( std::coroutine_handle<> handle );
+  void await_resume() { scheduled_ = false; }
+
+private:
+  friend class ByteStream;
+  ByteStream* stream_;
+  Until until_;
+  uint64_t n_;
+  std::coroutine_handle<> handle_ {};
+  WaiterList* list_ {};   // the list this awaiter is parked on, if any
+  bool scheduled_ {};     // handed to EventLoop::schedule() but not resumed yet
+};
+
 class Writer : public ByteStream
 {
 public:
   void push( std::string data ); // Push data to stream, but only as much as available capacity allows.
+
+  // Zero-copy alternative to push(): reserve() returns up to `len` bytes of writable space inside the
+  // stream's own storage (never more than the available capacity), and commit() publishes the first
+  // `len` bytes written there. Each reserve() replaces the previous, uncommitted reservation, and a
+  // push() (or splice() into the stream) drops it: commit() then has nothing to publish.
+  std::span<char> reserve( uint64_t len );
+  void commit( uint64_t len );
+
   void close();                  // Signal that the stream has reached its ending. Nothing more will be written.
 
+  // Raise the capacity to `capacity` bytes (a smaller value leaves it as it is). Chunked backend only:
+  // the Ring backend's buffer is sized once, by the constructor.
+  void grow_capacity( uint64_t capacity );
+
+  Awaiter writable( uint64_t n ) { return { *this, Awaiter::Until::Writable, n }; } // co_await until `n` bytes fit
+
   bool is_closed() const;              // Has the stream been closed?
   uint64_t available_capacity() const; // How many bytes can be pushed to the stream right now?
   uint64_t bytes_pushed() const;       // Total number of bytes cumulatively pushed to the stream
@@ -52,8 +186,16 @@ class Reader : public ByteStream
 {
 public:
   std::string_view peek() const; // Peek at the next bytes in the buffer
+  // Peek at the bytes starting `offset` bytes into the buffer (as far as they are contiguous). With the
+  // Chunked backend this is a binary search over the chunks.
+  std::string_view peek_at( uint64_t offset ) const;
+  // Peek at up to `max_views` views that, in order, cover the front of the buffer (e.g. for writev)
+  std::vector<std::string_view> peek_views( size_t max_views ) const;
   void pop( uint64_t len );      // Remove `len` bytes from the buffer
 
+  Awaiter readable( uint64_t n ) { return { *this, Awaiter::Until::Readable, n }; } // co_await `n` buffered bytes
+  Awaiter finished() { return { *this, Awaiter::Until::Finished, 0 }; }             // co_await is_finished()
+
   bool is_finished() const;        // Is the stream finished (closed and fully popped)?
   uint64_t bytes_buffered() const; // Number of bytes currently buffered (pushed and not popped)
   uint64_t bytes_popped() const;   // Total number of bytes cumulatively popped from stream
@@ -64,3 +206,12 @@ public:
  * from a ByteStream Reader into a string;
  */
 void read( Reader& reader, uint64_t len, std::string& out );
+
+/*
+ * splice: Move up to `len` bytes from the front of `from` to the back of `to` (limited by
+ * what `from` has buffered and by `to`'s available capacity), and return how many moved.
+ * Between two Chunked streams, whole chunks change owner without being copied; only a
+ * chunk that is split by `len` is copied. Like reserve(), it drops any uncommitted
+ * reservation on `to`.
+ */
+uint64_t splice( Reader& from, Writer& to, uint64_t len );
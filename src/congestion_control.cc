@@ -0,0 +1,227 @@
+#include "congestion_control.hh"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+using namespace std;
+
+unique_ptr<CongestionControl> CongestionControl::make( Algorithm algorithm, uint64_t mss )
+{
+  switch ( algorithm ) {
+    case Algorithm::Reno:
+      return make_unique<Reno>( mss );
+    case Algorithm::CUBIC:
+      return make_unique<CUBIC>( mss );
+    case Algorithm::BBR:
+      return make_unique<BBR>( mss );
+    case Algorithm::None:
+      break;
+  }
+  return nullptr;
+}
+
+void Reno::on_ack( const Ack& ack )
+{
+  if ( cwnd_ < ssthresh_ ) {
+    // 慢启动：每个ack最多加一个MSS，一个RTT翻一倍
+    cwnd_ += min( ack.acked, mss_ );
+    return;
+  }
+  // 拥塞避免：每确认一个窗口的数据加一个MSS
+  acked_in_window_ += ack.acked;
+  if ( acked_in_window_ >= cwnd_ ) {
+    acked_in_window_ -= cwnd_;
+    cwnd_ += mss_;
+  }
+}
+
+void Reno::on_loss( uint64_t in_flight, uint64_t /* now_ms */ )
+{
+  ssthresh_ = max( in_flight / 2, 2 * mss_ );
+  cwnd_ = ssthresh_;
+  acked_in_window_ = 0;
+}
+
+void Reno::on_rto( uint64_t in_flight, uint64_t /* now_ms */ )
+{
+  ssthresh_ = max( in_flight / 2, 2 * mss_ );
+  cwnd_ = mss_;
+  acked_in_window_ = 0;
+}
+
+void CUBIC::on_ack( const Ack& ack )
+{
+  if ( ack.rtt_ms.has_value() ) {
+    min_rtt_ms_ = min( min_rtt_ms_, *ack.rtt_ms );
+  }
+  if ( cwnd_ < ssthresh_ ) {
+    cwnd_ += min( ack.acked, mss_ );
+    return;
+  }
+
+  const double mss = static_cast<double>( mss_ );
+  const double cwnd = static_cast<double>( cwnd_ );
+  if ( not epoch_start_ms_.has_value() ) {
+    // 新的拥塞避免阶段：从现在的窗口出发，K秒后回到W_max
+    epoch_start_ms_ = ack.now_ms;
+    if ( w_max_ <= cwnd ) {
+      w_max_ = cwnd;
+      k_s_ = 0;
+    } else {
+      k_s_ = cbrt( ( w_max_ - cwnd ) / mss / C );
+    }
+    w_est_ = cwnd;
+  }
+
+  // W_cubic(t + RTT) = C (t + RTT - K)^3 + W_max，以段为单位；每个RTT最多涨到1.5倍
+  const uint64_t rtt_ms = min_rtt_ms_ == UINT64_MAX ? 0 : min_rtt_ms_;
+  const double t = static_cast<double>( ack.now_ms - *epoch_start_ms_ + rtt_ms ) / 1000;
+  double target = ( C * pow( t - k_s_, 3 ) ) * mss + w_max_;
+  target = clamp( target, cwnd, 1.5 * cwnd );
+
+  // 不比Reno慢：按相同的丢包率，Reno这时候的窗口
+  w_est_ += 3 * ( 1 - beta ) / ( 1 + beta ) * mss * static_cast<double>( ack.acked ) / cwnd;
+  target = max( target, w_est_ );
+
+  cwnd_ += static_cast<uint64_t>( ( target - cwnd ) * static_cast<double>( ack.acked ) / cwnd );
+}
+
+void CUBIC::reduce()
+{
+  const double cwnd = static_cast<double>( cwnd_ );
+  // 快速收敛：窗口比上次丢包时还小，说明有新的流进来，W_max也让出一些
+  w_max_ = cwnd < w_max_ ? cwnd * ( 1 + beta ) / 2 : cwnd;
+  ssthresh_ = max( static_cast<uint64_t>( cwnd * beta ), 2 * mss_ );
+  epoch_start_ms_.reset();
+}
+
+void CUBIC::on_loss( uint64_t /* in_flight */, uint64_t /* now_ms */ )
+{
+  reduce();
+  cwnd_ = ssthresh_;
+}
+
+void CUBIC::on_rto( uint64_t /* in_flight */, uint64_t /* now_ms */ )
+{
+  reduce();
+  cwnd_ = mss_;
+}
+
+namespace {
+// ProbeBW: one round probing for more bandwidth, one draining the queue that made, then six cruising
+constexpr array<double, 8> probe_bw_gains { 1.25, 0.75, 1, 1, 1, 1, 1, 1 };
+constexpr double probe_bw_cwnd_gain = 2;
+} // namespace
+
+uint64_t BBR::bottleneck_bandwidth() const
+{
+  uint64_t bandwidth = round_max_rate_;
+  for ( const auto& [round, sample] : bandwidth_samples_ ) {
+    bandwidth = max( bandwidth, sample );
+  }
+  return bandwidth;
+}
+
+optional<uint64_t> BBR::min_rtt_ms() const
+{
+  return min_rtt_ms_;
+}
+
+uint64_t BBR::bdp() const
+{
+  return bottleneck_bandwidth() * min_rtt_ms_.value_or( 0 ) / 1000;
+}
+
+double BBR::pacing_gain() const
+{
+  switch ( phase_ ) {
+    case Phase::Startup:
+      return startup_gain;
+    case Phase::Drain:
+      return 1 / startup_gain;
+    case Phase::ProbeBW:
+      break;
+  }
+  return probe_bw_gains.at( cycle_index_ );
+}
+
+uint64_t BBR::cwnd() const
+{
+  if ( after_rto_ ) {
+    return mss_;
+  }
+  if ( bottleneck_bandwidth() == 0 ) {
+    return initial_window_segments * mss_; // 还没有模型
+  }
+  const double gain = phase_ == Phase::ProbeBW ? probe_bw_cwnd_gain : startup_gain;
+  const uint64_t cwnd = max( static_cast<uint64_t>( gain * static_cast<double>( bdp() ) ), 4 * mss_ );
+  return phase_ == Phase::Startup ? max( cwnd, initial_window_segments * mss_ ) : cwnd;
+}
+
+uint64_t BBR::pacing_rate() const
+{
+  uint64_t bandwidth = bottleneck_bandwidth();
+  if ( phase_ == Phase::Startup and min_rtt_ms_.has_value() ) {
+    // 一开始的样本只有握手那点数据，至少按每个RTT一个初始窗口的速率起步
+    bandwidth = max( bandwidth, initial_window_segments * mss_ * 1000 / max<uint64_t>( *min_rtt_ms_, 1 ) );
+  }
+  return static_cast<uint64_t>( pacing_gain() * static_cast<double>( bandwidth ) );
+}
+
+void BBR::on_ack( const Ack& ack )
+{
+  after_rto_ = false;
+  if ( ack.rtt_ms.has_value()
+       and ( not min_rtt_ms_.has_value() or *ack.rtt_ms <= *min_rtt_ms_
+             or ack.now_ms - min_rtt_stamp_ms_ > min_rtt_window_ms ) ) {
+    min_rtt_ms_ = ack.rtt_ms;
+    min_rtt_stamp_ms_ = ack.now_ms;
+  }
+  if ( not min_rtt_ms_.has_value() ) {
+    return;
+  }
+  if ( ack.delivery_rate.has_value() ) {
+    round_max_rate_ = max( round_max_rate_, *ack.delivery_rate );
+  }
+
+  // 每过一个min RTT算一轮，这一轮最高的交付速率是一个带宽样本
+  if ( ack.now_ms - round_start_ms_ >= max<uint64_t>( *min_rtt_ms_, 1 ) ) {
+    new_round( ack );
+  }
+  if ( phase_ == Phase::Drain and ack.in_flight <= bdp() ) {
+    phase_ = Phase::ProbeBW;
+    cycle_index_ = 2;
+  }
+}
+
+void BBR::new_round( const Ack& ack )
+{
+  bandwidth_samples_.emplace_back( round_, round_max_rate_ );
+  while ( bandwidth_samples_.front().first + bandwidth_window_rounds <= round_ ) {
+    bandwidth_samples_.pop_front();
+  }
+  round_max_rate_ = 0;
+  round_++;
+  round_start_ms_ = ack.now_ms;
+
+  if ( phase_ == Phase::Startup ) {
+    // 连续三轮带宽涨不到25%，说明管道满了，把Startup造成的队列排掉
+    const uint64_t bandwidth = bottleneck_bandwidth();
+    if ( bandwidth >= full_bandwidth_ + full_bandwidth_ / 4 ) {
+      full_bandwidth_ = bandwidth;
+      full_bandwidth_rounds_ = 0;
+    } else if ( ++full_bandwidth_rounds_ >= 3 ) {
+      phase_ = Phase::Drain;
+    }
+  } else if ( phase_ == Phase::ProbeBW ) {
+    cycle_index_ = ( cycle_index_ + 1 ) % probe_bw_gains.size();
+  }
+}
+
+void BBR::on_loss( uint64_t /* in_flight */, uint64_t /* now_ms */ ) {}
+
+void BBR::on_rto( uint64_t /* in_flight */, uint64_t /* now_ms */ )
+{
+  after_rto_ = true;
+}
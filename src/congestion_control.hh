@@ -0,0 +1,162 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <utility>
+
+/*
+ * How much a TCPSender may have in flight (and how fast it may send), decided from what its ACKs
+ * say about the path. The sender keeps at most min(cwnd(), the receiver's window) sequence numbers
+ * in flight, and if pacing_rate() is nonzero it also spreads its segments out at that rate.
+ *
+ * The sender calls on_ack() for every ACK that acknowledges something new, on_loss() when it
+ * starts a fast retransmission (at most once per window of data), and on_rto() when the
+ * retransmission timer expires. Windows are in sequence numbers, like the sender's in-flight count.
+ */
+class CongestionControl
+{
+public:
+  enum class Algorithm : uint8_t
+  {
+    None, // no congestion window: only the receiver's window limits the sender
+    Reno,
+    CUBIC,
+    BBR,
+  };
+
+  struct Ack
+  {
+    uint64_t acked {};              // sequence numbers newly acknowledged
+    uint64_t in_flight {};          // sequence numbers still outstanding after this ACK
+    uint64_t delivered {};          // sequence numbers acknowledged so far, in total
+    uint64_t now_ms {};             // the sender's clock
+    std::optional<uint64_t> rtt_ms; // a round-trip sample, when the ACK gives a valid one (Karn)
+    // bytes per second acknowledged since the newest segment this ACK covers was sent, measured from
+    // the last ACK before that, so a cumulative ACK after a repaired loss doesn't look like a burst
+    std::optional<uint64_t> delivery_rate;
+  };
+
+  explicit CongestionControl( uint64_t mss ) : mss_( mss ) {}
+  virtual ~CongestionControl() = default;
+  CongestionControl( const CongestionControl& other ) = delete;
+  CongestionControl& operator=( const CongestionControl& other ) = delete;
+
+  virtual std::string_view name() const = 0;
+  virtual uint64_t cwnd() const = 0;
+  virtual uint64_t pacing_rate() const { return 0; } // bytes per second, or 0 not to pace
+
+  virtual void on_ack( const Ack& ack ) = 0;
+  virtual void on_loss( uint64_t in_flight, uint64_t now_ms ) = 0;
+  virtual void on_rto( uint64_t in_flight, uint64_t now_ms ) = 0;
+
+  // nullptr for Algorithm::None
+  static std::unique_ptr<CongestionControl> make( Algorithm algorithm, uint64_t mss );
+
+protected:
+  uint64_t mss_;
+  static constexpr uint64_t initial_window_segments = 10; // RFC 6928
+};
+
+// RFC 5681: slow start, then one segment per window of ACKed data; halve on loss, and go back to
+// one segment (and slow start) on a timeout.
+class Reno : public CongestionControl
+{
+public:
+  explicit Reno( uint64_t mss ) : CongestionControl( mss ) {}
+
+  std::string_view name() const override { return "Reno"; }
+  uint64_t cwnd() const override { return cwnd_; }
+  uint64_t ssthresh() const { return ssthresh_; }
+
+  void on_ack( const Ack& ack ) override;
+  void on_loss( uint64_t in_flight, uint64_t now_ms ) override;
+  void on_rto( uint64_t in_flight, uint64_t now_ms ) override;
+
+private:
+  uint64_t cwnd_ { initial_window_segments * mss_ };
+  uint64_t ssthresh_ { UINT64_MAX };
+  uint64_t acked_in_window_ { 0 }; // for congestion avoidance's byte counting
+};
+
+// RFC 9438: after a loss the window grows along a cubic curve in the time since the loss, flat near
+// the window where the loss happened (W_max) and fast away from it, and never slower than Reno.
+class CUBIC : public CongestionControl
+{
+public:
+  explicit CUBIC( uint64_t mss ) : CongestionControl( mss ) {}
+
+  std::string_view name() const override { return "CUBIC"; }
+  uint64_t cwnd() const override { return cwnd_; }
+  uint64_t ssthresh() const { return ssthresh_; }
+  uint64_t w_max() const { return static_cast<uint64_t>( w_max_ ); }
+
+  void on_ack( const Ack& ack ) override;
+  void on_loss( uint64_t in_flight, uint64_t now_ms ) override;
+  void on_rto( uint64_t in_flight, uint64_t now_ms ) override;
+
+  static constexpr double C = 0.4;
+  static constexpr double beta = 0.7;
+
+private:
+  void reduce();
+
+  uint64_t cwnd_ { initial_window_segments * mss_ };
+  uint64_t ssthresh_ { UINT64_MAX };
+  double w_max_ { 0 };                       // in bytes
+  std::optional<uint64_t> epoch_start_ms_ {}; // when congestion avoidance started since the last loss
+  double k_s_ { 0 };                          // seconds from the epoch start until the curve reaches W_max
+  double w_est_ { 0 };                        // the window Reno would have, in bytes
+  uint64_t min_rtt_ms_ { UINT64_MAX };
+};
+
+// A simplified BBR: the window and the pacing rate come from a model of the path (the highest
+// recent delivery rate and the lowest recent RTT) rather than from losses. It has the Startup,
+// Drain and ProbeBW phases but no ProbeRTT; the RTT estimate only ages out after min_rtt_window_ms.
+class BBR : public CongestionControl
+{
+public:
+  explicit BBR( uint64_t mss ) : CongestionControl( mss ) {}
+
+  enum class Phase : uint8_t
+  {
+    Startup,
+    Drain,
+    ProbeBW,
+  };
+
+  std::string_view name() const override { return "BBR"; }
+  uint64_t cwnd() const override;
+  uint64_t pacing_rate() const override;
+
+  Phase phase() const { return phase_; }
+  uint64_t bottleneck_bandwidth() const; // bytes per second
+  std::optional<uint64_t> min_rtt_ms() const;
+
+  void on_ack( const Ack& ack ) override;
+  void on_loss( uint64_t in_flight, uint64_t now_ms ) override;
+  void on_rto( uint64_t in_flight, uint64_t now_ms ) override;
+
+  static constexpr double startup_gain = 2.89; // 2/ln(2): doubles the sending rate every round
+  static constexpr uint64_t bandwidth_window_rounds = 10;
+  static constexpr uint64_t min_rtt_window_ms = 10'000;
+
+private:
+  uint64_t bdp() const;
+  double pacing_gain() const;
+  void new_round( const Ack& ack );
+
+  Phase phase_ { Phase::Startup };
+  std::deque<std::pair<uint64_t, uint64_t>> bandwidth_samples_ {}; // (round, its highest delivery rate)
+  uint64_t round_max_rate_ { 0 };
+  std::optional<uint64_t> min_rtt_ms_ {};
+  uint64_t min_rtt_stamp_ms_ { 0 };
+  uint64_t round_ { 0 };
+  uint64_t round_start_ms_ { 0 };
+  uint64_t full_bandwidth_ { 0 }; // Startup ends when the bandwidth stops growing by 25% a round...
+  uint64_t full_bandwidth_rounds_ { 0 }; // ...for three rounds
+  uint64_t cycle_index_ { 0 };
+  bool after_rto_ { false }; // one segment in flight until the next ACK
+};
@@ -1,103 +1,348 @@
 #include "reassembler.hh"
+#include <algorithm>
+#include <bit>
 #include <cstdint>
+#include <cstring>
+#include <iterator>
 #include <string>
 #include <type_traits>
 #include <utility>
 
 using namespace std;
 
+Reassembler::Reassembler( ByteStream&& output, Mode mode, pmr::memory_resource* arena )
+  : output_( std::move( output ) ), extents_( arena ), mode_( mode )
+{
+  if ( mode_ == Mode::Window ) {
+    // 窗口大小等于流的总容量：待重组的字节一定落在 [first_unassembled_index, +capacity) 之内，不会互相覆盖
+    const uint64_t capacity = output_.writer().available_capacity() + output_.reader().bytes_buffered();
+    window_.resize( capacity );
+    present_.resize( ( capacity + word_bits - 1 ) / word_bits );
+  }
+}
+
 void Reassembler::insert( uint64_t first_index, string data, bool is_last_substring )
 {
-  has_last = is_last_substring ? true : has_last;
   // judge if empty and need to check out of capacity
   first_unacceptable_index = first_unassembled_index + output_.writer().available_capacity();
+  // 最后一段只有完整落在窗口之内才算数：被截断或者整个被丢掉的话，结尾要等重传再确认
+  has_last = has_last || ( is_last_substring && first_index + data.size() <= first_unacceptable_index );
   // 数据非空的、没有超过可接受范围的、没有之前被完整assemble过的才会进入insert处理
   if ( !data.empty() && first_index < first_unacceptable_index
        && first_index + data.size() > first_unassembled_index ) {
-    // data和first需要一个预处理，主要是处理已经发送的data，也就是在first_unassembled_index之前的index内容去掉
-    if ( first_index < first_unassembled_index && first_index + data.size() > first_unassembled_index ) {
-      data = data.substr( first_unassembled_index - first_index ); // 截取到能够接受的index之后
-      first_index = first_unassembled_index;
-    }
-    if ( data.size() + first_index > first_unacceptable_index ) { // 在这里把data截断
-      data = data.substr( 0, first_unacceptable_index - first_index );
-      has_last = false;
-    }
-    // using function to strip and insert the data
-    bytes_pending_num += find_replace_addStr( data, first_index );
-    // check if the nextBytes come then write bytes
-    while ( !data_set.empty() && first_index == first_unassembled_index ) {
-      // 更新pendding数量
-      bytes_pending_num -= data_set.begin()->second.size();
-      // 更新跟踪信息：first_unassembled_index、first_unacceptable_index
-      first_unassembled_index += data_set.begin()->second.size();
-      // 发送push数据
-      output_.writer().push( move( data_set.begin()->second ) );
-      data_set.erase( data_set.begin() );
-      first_index = data_set.begin()->first; // 走到下一个元素
+    if ( mode_ == Mode::Window && first_index > first_unassembled_index ) {
+      // 窗口模式下接不上的数据直接拷进环形窗口，不需要先裁剪出一个新字符串
+      const uint64_t last_index = min( first_index + data.size(), first_unacceptable_index );
+      window_write( first_index, string_view { data }.substr( 0, last_index - first_index ) );
+      discard( move( data ) );
+    } else {
+      // data和first需要一个预处理，主要是处理已经发送的data，也就是在first_unassembled_index之前的index内容去掉
+      if ( first_index < first_unassembled_index && first_index + data.size() > first_unassembled_index ) {
+        data.erase( 0, first_unassembled_index - first_index ); // 截取到能够接受的index之后（原地截取，不再分配）
+        first_index = first_unassembled_index;
+      }
+      if ( data.size() + first_index > first_unacceptable_index ) { // 在这里把data截断
+        data.resize( first_unacceptable_index - first_index );
+      }
+      if ( mode_ == Mode::Window || first_index == first_unassembled_index ) {
+        push_run( move( data ) );
+      } else {
+        store( first_index, move( data ) );
+      }
     }
   }
+  settle_budget();
   // if this is the last substring and it's not cut the tail
-  if ( has_last && data_set.empty() ) {
+  if ( has_last && bytes_pending_num == 0 ) {
     output_.writer().close();
     return;
   }
 }
+/*
+批量插入：先按 index 排序，然后把能从 first_unassembled_index 开始连成一片的数据都拼进 run，
+接不上的照常存起来（存之前先看看已经缓存的区间能不能把 run 接长），最后 run 只 push 一次。
+first_unacceptable_index 也只算一次——run 还没写进去，它占的正是这段空间。
+*/
+void Reassembler::insert_batch( span<Segment> segments )
+{
+  ranges::sort( segments, {}, &Segment::first_index );
+  first_unacceptable_index = first_unassembled_index + output_.writer().available_capacity();
+  string run;
+  for ( auto& [first_index, data, is_last_substring] : segments ) {
+    has_last = has_last || ( is_last_substring && first_index + data.size() <= first_unacceptable_index );
+    if ( data.empty() || first_index >= first_unacceptable_index ) {
+      continue;
+    }
+    if ( data.size() + first_index > first_unacceptable_index ) {
+      data.resize( first_unacceptable_index - first_index );
+    }
+    if ( mode_ == Mode::Extents && !run.empty() && first_index > first_unassembled_index + run.size() ) {
+      absorb_following( first_unassembled_index, run );
+    }
+    const uint64_t run_end = first_unassembled_index + run.size();
+    if ( first_index + data.size() <= run_end ) {
+      discard( move( data ) );
+    } else if ( first_index > run_end ) {
+      if ( mode_ == Mode::Window ) {
+        window_write( first_index, data );
+        discard( move( data ) );
+      } else {
+        store( first_index, move( data ) );
+      }
+    } else if ( run.empty() ) {
+      data.erase( 0, first_unassembled_index - first_index );
+      run = move( data );
+    } else {
+      run.append( string_view { data }.substr( run_end - first_index ) );
+      discard( move( data ) );
+    }
+  }
+  if ( !run.empty() ) {
+    push_run( move( run ) );
+  }
+  settle_budget();
+  if ( has_last && bytes_pending_num == 0 ) {
+    output_.writer().close();
+  }
+}
+
 // How many bytes are stored in the Reassembler itself?
 uint64_t Reassembler::bytes_pending() const
 {
   return bytes_pending_num;
 }
+
+vector<Reassembler::Range> Reassembler::pending_ranges( size_t max ) const
+{
+  vector<Range> ranges;
+  if ( mode_ == Mode::Extents ) {
+    for ( auto it = extents_.begin(); it != extents_.end() && ranges.size() < max; ++it ) {
+      ranges.emplace_back( it->first, it->first + it->second.size() );
+    }
+    return ranges;
+  }
+  // 窗口模式：交替地跳过缺的字节、数出到了的字节，数够 bytes_pending_num 个就不用再往后找了
+  uint64_t index = first_unassembled_index;
+  uint64_t found = 0;
+  while ( found < bytes_pending_num && ranges.size() < max ) {
+    index += window_span( index, false );
+    const uint64_t n = window_span( index, true );
+    ranges.emplace_back( index, index + n );
+    found += n;
+    index += n;
+  }
+  return ranges;
+}
+
+optional<Reassembler::Range> Reassembler::pending_range( uint64_t index ) const
+{
+  if ( mode_ == Mode::Extents ) {
+    auto next = extents_.upper_bound( index );
+    if ( next == extents_.begin() ) {
+      return nullopt;
+    }
+    const auto& [first, data] = *std::prev( next );
+    return index < first + data.size() ? optional { Range { first, first + data.size() } } : nullopt;
+  }
+  uint64_t first = first_unassembled_index;
+  uint64_t found = 0;
+  while ( found < bytes_pending_num && first <= index ) {
+    first += window_span( first, false );
+    const uint64_t n = window_span( first, true );
+    if ( first <= index && index < first + n ) {
+      return Range { first, first + n };
+    }
+    found += n;
+    first += n;
+  }
+  return nullopt;
+}
 /*
-大致思路是，使用set的方法，找到第一个小于等于输入字符串index的元素（需要使用upper_bound，得到迭代器并且往前推一个）
-然后再找到第一个大于等于index+len-1的元素，然后这两个元素之间的所有元素，都会参与切割这个字符串
-切割操作是：从第一个元素开始，字符串分割为(0,index_ele-index)和(index_ele-index+ele.size)
-对于前一个分割，直接加入set，对于后一个，继续进行分割。
+extents_ 里存的是互不重叠、也互不相邻的区间（相邻的会立刻合并），按起始 index 排序。
+新数据进来时只需要找到它前面的那个区间和它覆盖到的后面几个区间：
+  - 和前一个区间重叠或相邻：只把新数据超出的那一段追加到前一个区间后面
+  - 否则新数据自己成为一个区间
+然后把后面被覆盖到的区间并进来（只追加超出的那一段）并删掉它们。
+这样每次插入是 O(log n + k)，已经缓存的数据不会被切开重新拷贝。
 */
-uint64_t Reassembler::find_replace_addStr( string& input_str, const uint64_t& first_index )
-{
-  // 对于最特殊的 data_set是空的情况，直接插入：
-  if ( data_set.begin() == data_set.end() ) {
-    auto size = input_str.size();
-    data_set.insert( { first_index, move( input_str ) } );
-    return size;
-  }
-  set<pair<uint64_t, string>>::iterator iter_down = data_set.upper_bound( { first_index, "" } );
-  set<pair<uint64_t, string>>::iterator iter_up = data_set.upper_bound( { first_index + input_str.size(), "" } );
-  // 思路是对于上界的划分精细
-  if ( iter_down != data_set.begin() ) {
-    iter_down--;
-  } else if ( iter_down == iter_up ) { // 这个说明data_set的所有index都比first_index大，那么就需要在iter_down ==
-                                       // iter_up的时候去调整iter_down 向后
-    iter_up++;
-  }
-  // 前面保证了iter_down 不会取到end
-  uint64_t count_insert = 0, start_index = first_index; // 记录插入的bytes数
-  string opeStr = input_str;
-  // 截取操作进行规范，我们需要定义关键位置：理解这几个公式需要画图
-  uint64_t leftDownIndex = 0, leftUpIndex = 0, rightDownIndex = 0, rightUpindex = 0;
-  // 开始遍历分割字符串
-  for ( ; iter_down != iter_up; iter_down++ ) {
-    // 更新关键位置变量：
-    leftDownIndex = min( iter_down->first, start_index );
-    leftUpIndex = min( iter_down->first, start_index + opeStr.size() );
-    rightDownIndex = max( iter_down->first + iter_down->second.size(), start_index );
-    rightUpindex = max( iter_down->first + iter_down->second.size(), start_index + opeStr.size() );
-    // 截取
-    if ( leftDownIndex != leftUpIndex ) {
-      auto insertStr = opeStr.substr( 0, leftUpIndex - leftDownIndex );
-      data_set.insert( { leftDownIndex, move( insertStr ) } );
+void Reassembler::store( uint64_t first_index, string data )
+{
+  const uint64_t last_index = first_index + data.size();
+  auto next = extents_.upper_bound( first_index );
+  if ( next != extents_.begin() ) {
+    auto& [prev_index, prev_data] = *std::prev( next );
+    const uint64_t prev_end = prev_index + prev_data.size();
+    if ( prev_end >= first_index ) {
+      if ( prev_end < last_index ) {
+        const auto tail = string_view { data }.substr( prev_end - first_index );
+        prev_data.append( tail );
+        bytes_pending_num += tail.size();
+        bytes_pending_num += absorb_following( prev_index, prev_data );
+      }
+      discard( move( data ) );
+      return;
+    }
+  }
+  bytes_pending_num += data.size();
+  auto& [index, extent] = *extents_.emplace_hint( next, first_index, move( data ) );
+  bytes_pending_num += absorb_following( index, extent );
+}
+
+// 把紧跟在 [start, start + extent.size()) 后面、与它重叠或相邻的区间并进 extent，返回追加的字节数
+uint64_t Reassembler::absorb_following( uint64_t start, string& extent )
+{
+  uint64_t appended = 0;
+  auto next = extents_.upper_bound( start );
+  while ( next != extents_.end() && next->first <= start + extent.size() ) {
+    const uint64_t end = start + extent.size();
+    const uint64_t next_end = next->first + next->second.size();
+    if ( next_end > end ) {
+      extent.append( string_view { next->second }.substr( end - next->first ) );
+      appended += next_end - end;
     }
-    // 更新start、opeStr
-    opeStr = rightDownIndex == rightUpindex
-               ? ""
-               : opeStr.substr( rightDownIndex - start_index, rightUpindex - rightDownIndex );
-    start_index = rightDownIndex;
-    count_insert += leftUpIndex - leftDownIndex;
-  }
-  if ( !opeStr.empty() ) {
-    count_insert += opeStr.size();
-    data_set.insert( { rightDownIndex, move( opeStr ) } );
-  }
-  return count_insert;
+    bytes_pending_num -= next->second.size();
+    discard( move( next->second ) );
+    next = extents_.erase( next );
+  }
+  return appended;
+}
+
+// run 从 first_unassembled_index 开始：连同缓存里紧跟在后面的字节一起写出
+void Reassembler::push_run( string&& run )
+{
+  if ( mode_ == Mode::Window ) {
+    // 窗口里和它重叠的字节作废，再把后面接着的连续字节一起写出
+    bytes_pending_num -= window_mark( first_unassembled_index, run.size(), false );
+    first_unassembled_index += run.size();
+    output_.writer().push( move( run ) );
+    window_flush();
+  } else {
+    // 不经过 extents_，直接把紧跟在后面的缓存区间并进来
+    absorb_following( first_unassembled_index, run );
+    first_unassembled_index += run.size();
+    output_.writer().push( move( run ) );
+  }
+}
+
+void Reassembler::set_budget( shared_ptr<ReassemblyBudget> budget )
+{
+  account_ = ReassemblyBudget::Account { move( budget ) };
+  settle_budget();
+}
+
+void Reassembler::settle_budget()
+{
+  if ( mode_ == Mode::Extents && account_.active() ) {
+    evict_farthest( account_.settle( bytes_pending_num ) );
+  }
+}
+
+// 预算不够时从 extents_ 的最远端开始丢数据：那是发送方最晚才会重传的部分
+void Reassembler::evict_farthest( uint64_t len )
+{
+  if ( len == 0 ) {
+    return;
+  }
+  bytes_evicted_ += len;
+  bytes_pending_num -= len;
+  while ( len > 0 ) {
+    auto last = std::prev( extents_.end() );
+    if ( last->second.size() > len ) {
+      last->second.resize( last->second.size() - len );
+      break;
+    }
+    len -= last->second.size();
+    discard( move( last->second ) );
+    extents_.erase( last );
+  }
+  // 最后一个字节一定在最远端，已经被丢掉了，要等重传的 FIN 再确认结尾
+  has_last = false;
+}
+
+void Reassembler::discard( string&& buffer )
+{
+  if ( output_.buffer_pool() ) {
+    output_.buffer_pool()->release( move( buffer ) );
+  }
+}
+
+/*
+窗口模式：下标为 i 的字节存放在 window_[i % window_.size()]，present_ 的对应位表示它是否已经到达。
+重叠的数据只是重复 memcpy 同样的字节、重复置位，不需要任何切分或者分配。
+*/
+void Reassembler::window_write( uint64_t first_index, string_view data )
+{
+  const uint64_t pos = first_index % window_.size();
+  const uint64_t first_part = min<uint64_t>( data.size(), window_.size() - pos );
+  memcpy( window_.data() + pos, data.data(), first_part );
+  memcpy( window_.data(), data.data() + first_part, data.size() - first_part );
+  bytes_pending_num += window_mark( first_index, data.size(), true );
+}
+
+// 把 [first_index, +len) 对应的位全部置为 present（可能跨过窗口末尾），返回真正改变了的位数
+uint64_t Reassembler::window_mark( uint64_t first_index, uint64_t len, bool present )
+{
+  if ( len == 0 ) {
+    return 0;
+  }
+  uint64_t pos = first_index % window_.size();
+  uint64_t changed = 0;
+  while ( len > 0 ) {
+    // 一次处理一个 64 位字里的一段，用 popcount 数出改变的位
+    const uint64_t bit = pos % word_bits;
+    const uint64_t n = min( { word_bits - bit, len, window_.size() - pos } );
+    const uint64_t mask = ( n == word_bits ? ~uint64_t {} : ( ( uint64_t { 1 } << n ) - 1 ) ) << bit;
+    uint64_t& word = present_[pos / word_bits];
+    changed += popcount( present ? mask & ~word : mask & word );
+    word = present ? word | mask : word & ~mask;
+    len -= n;
+    pos = pos + n == window_.size() ? 0 : pos + n;
+  }
+  return changed;
+}
+
+// 从 first_unassembled_index 开始的连续 present 字节数
+uint64_t Reassembler::window_run() const
+{
+  return window_span( first_unassembled_index, true );
+}
+
+// 从 first_index 开始、一直到窗口另一端为止，连续 present（或者连续不 present）的字节数（用 countr_one 一次数一个字）
+uint64_t Reassembler::window_span( uint64_t first_index, bool present ) const
+{
+  const uint64_t total = first_unassembled_index + window_.size() - first_index;
+  uint64_t pos = first_index % window_.size();
+  uint64_t span = 0;
+  while ( span < total ) {
+    const uint64_t bit = pos % word_bits;
+    const uint64_t limit = min( word_bits - bit, window_.size() - pos );
+    const uint64_t word = present ? present_[pos / word_bits] : ~present_[pos / word_bits];
+    const uint64_t n = min<uint64_t>( countr_one( word >> bit ), limit );
+    span += n;
+    if ( n < limit ) {
+      break;
+    }
+    pos = pos + n == window_.size() ? 0 : pos + n;
+  }
+  return min( span, total );
+}
+
+// 把窗口里从 first_unassembled_index 开始的连续字节一次写进 ByteStream
+void Reassembler::window_flush()
+{
+  if ( window_.empty() ) {
+    return;
+  }
+  const uint64_t run = window_run();
+  if ( run == 0 ) {
+    return;
+  }
+  const uint64_t pos = first_unassembled_index % window_.size();
+  const uint64_t first_part = min( run, window_.size() - pos );
+  const auto space = output_.writer().reserve( run );
+  memcpy( space.data(), window_.data() + pos, first_part );
+  memcpy( space.data() + first_part, window_.data(), run - first_part );
+  output_.writer().commit( run );
+  bytes_pending_num -= window_mark( first_unassembled_index, run, false );
+  first_unassembled_index += run;
 }
@@ -1,16 +1,36 @@
 #pragma once
 
 #include "byte_stream.hh"
+#include "reassembly_budget.hh"
 #include <cstdint>
-#include <set>
+#include <memory_resource>
+#include <map>
+#include <memory>
+#include <optional>
+#include <span>
 #include <string>
+#include <string_view>
 #include <utility>
+#include <vector>
 
 class Reassembler
 {
 public:
-  // Construct Reassembler to write into given ByteStream.
-  explicit Reassembler( ByteStream&& output ) : output_( std::move( output ) ) {}
+  // How bytes that can't be written yet are stored.
+  //   Extents: a map of merged, non-overlapping strings; memory grows with what is pending.
+  //   Window: a circular buffer the size of the stream's capacity plus a bitmap of which bytes have
+  //           arrived; memory is fixed, and overlap costs a memcpy and a few bit operations.
+  enum class Mode
+  {
+    Extents,
+    Window
+  };
+
+  // Construct Reassembler to write into given ByteStream. Its bookkeeping (not the bytes themselves,
+  // which move to and from std::strings without copies) is allocated from `arena`.
+  explicit Reassembler( ByteStream&& output,
+                        Mode mode = Mode::Extents,
+                        std::pmr::memory_resource* arena = std::pmr::get_default_resource() );
 
   /*
    * Insert a new substring to be reassembled into a ByteStream.
@@ -34,9 +54,31 @@ public:
    */
   void insert( uint64_t first_index, std::string data, bool is_last_substring );
 
+  // One substring, as passed to insert()
+  struct Segment
+  {
+    uint64_t first_index;
+    std::string data;
+    bool is_last_substring;
+  };
+
+  /*
+   * Insert many substrings at once (e.g. every segment read in one wakeup). Equivalent to calling
+   * insert() on each of them, but the segments are sorted first (the span is reordered in place)
+   * and everything that becomes contiguous is pushed to the ByteStream as a single write.
+   */
+  void insert_batch( std::span<Segment> segments );
+
   // How many bytes are stored in the Reassembler itself?
   uint64_t bytes_pending() const;
 
+  // The bytes stored in the Reassembler, as [first, last) index ranges: the first `max` ranges in
+  // increasing order, and the range that holds `index`, if one does. (A TCPReceiver reports them as
+  // SACK blocks.)
+  using Range = std::pair<uint64_t, uint64_t>;
+  std::vector<Range> pending_ranges( size_t max ) const;
+  std::optional<Range> pending_range( uint64_t index ) const;
+
   // Access output stream reader
   Reader& reader() { return output_.reader(); }
   const Reader& reader() const { return output_.reader(); }
@@ -44,6 +86,14 @@ public:
   // Access output stream writer, but const-only (can't write from outside)
   const Writer& writer() const { return output_.writer(); }
 
+  Mode mode() const { return mode_; }
+
+  // Charge the bytes held in extents_ against a budget shared with other Reassemblers (Window mode
+  // allocates its memory up front, so it is never charged). Pending bytes the budget can't cover
+  // are evicted, farthest first.
+  void set_budget( std::shared_ptr<ReassemblyBudget> budget );
+  uint64_t bytes_evicted() const { return bytes_evicted_; } // pending bytes dropped to stay within the budget
+
 private:
   ByteStream output_; // the Reassembler writes to this ByteStream
   // uint64_t first_unpopped_index { 0 };
@@ -51,8 +101,26 @@ private:
   uint64_t first_unacceptable_index { 0 }; // initial from the capacity of output_
   uint64_t bytes_pending_num { 0 };
   bool has_last { false };
-  std::pmr::set<std::pair<uint64_t, std::string>> data_set {};
-  uint64_t find_replace_addStr(
-    std::string& input_str,
-    const uint64_t& first_index ); // strip the inputStr to leave no overlapping and insert them into data_set;
+  // Pending bytes as non-overlapping, non-adjacent extents, keyed by the index of their first byte
+  std::pmr::map<uint64_t, std::string> extents_ {};
+  void store( uint64_t first_index, std::string data ); // merge `data` into extents_
+  uint64_t absorb_following( uint64_t start, std::string& extent ); // merge the extents that `extent` reaches
+  void discard( std::string&& buffer );                              // hand a dropped buffer back to the pool
+  void push_run( std::string&& run ); // write bytes starting at first_unassembled_index, and what follows them
+
+  ReassemblyBudget::Account account_ {};
+  uint64_t bytes_evicted_ { 0 };
+  void settle_budget();                // charge bytes_pending_num, evicting what the budget won't cover
+  void evict_farthest( uint64_t len ); // drop `len` pending bytes from the far end of extents_
+
+  // Window mode
+  static constexpr uint64_t word_bits = 64;
+  Mode mode_;
+  std::string window_ {};           // byte i is stored at window_[i % window_.size()]
+  std::vector<uint64_t> present_ {}; // bit (i % window_.size()) is set once byte i has arrived
+  void window_write( uint64_t first_index, std::string_view data );
+  uint64_t window_mark( uint64_t first_index, uint64_t len, bool present ); // returns how many bits changed
+  uint64_t window_run() const; // number of bytes present from first_unassembled_index on
+  uint64_t window_span( uint64_t first_index, bool present ) const; // bytes from first_index on, (not) present
+  void window_flush();         // push that run to the output in one piece
 };
@@ -0,0 +1,61 @@
+#include "reassembly_budget.hh"
+
+#include <algorithm>
+#include <utility>
+
+using namespace std;
+
+uint64_t ReassemblyBudget::charge( uint64_t bytes )
+{
+  // 能给多少给多少：剩余额度不够时只批一部分，用 CAS 保证多个线程同时申请也不会超限
+  uint64_t used = used_.load( memory_order_relaxed );
+  uint64_t granted = 0;
+  do {
+    granted = min( bytes, limit_ > used ? limit_ - used : 0 );
+  } while ( not used_.compare_exchange_weak( used, used + granted, memory_order_relaxed ) );
+  return granted;
+}
+
+void ReassemblyBudget::credit( uint64_t bytes )
+{
+  used_.fetch_sub( bytes, memory_order_relaxed );
+}
+
+ReassemblyBudget::Account::Account( Account&& other ) noexcept
+  : budget_( move( other.budget_ ) ), charged_( exchange( other.charged_, 0 ) )
+{}
+
+ReassemblyBudget::Account& ReassemblyBudget::Account::operator=( Account&& other ) noexcept
+{
+  if ( this != &other ) {
+    settle( 0 );
+    budget_ = move( other.budget_ );
+    charged_ = exchange( other.charged_, 0 );
+  }
+  return *this;
+}
+
+ReassemblyBudget::Account::~Account()
+{
+  settle( 0 );
+}
+
+uint64_t ReassemblyBudget::Account::settle( uint64_t pending )
+{
+  if ( not budget_ ) {
+    return 0;
+  }
+  if ( pending <= charged_ ) {
+    budget_->credit( charged_ - pending );
+    charged_ = pending;
+    return 0;
+  }
+  const uint64_t granted = budget_->charge( pending - charged_ );
+  charged_ += granted;
+  const uint64_t over = pending - charged_;
+  if ( over > 0 ) {
+    budget_->bytes_evicted_.fetch_add( over, memory_order_relaxed );
+    budget_->evictions_.fetch_add( 1, memory_order_relaxed );
+  }
+  return over;
+}
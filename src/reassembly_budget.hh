@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+/*
+ * A limit on the out-of-order bytes held by many Reassemblers together (e.g. every connection of
+ * one host), so that a large receive capacity doesn't mean connections x capacity of memory at
+ * worst. It is thread-safe: the connections may each run on their own thread.
+ *
+ * Each Reassembler holds an Account and settles it after every insert, charging the budget for
+ * the bytes it is storing. Whatever the budget can't grant, that Reassembler evicts from its own
+ * pending bytes, farthest from the next byte it needs first (the ones a sender will retransmit
+ * last anyway). Evicting from other connections instead would mean touching them from this thread.
+ */
+class ReassemblyBudget
+{
+public:
+  explicit ReassemblyBudget( uint64_t limit ) : limit_( limit ) {}
+
+  uint64_t limit() const { return limit_; }
+  uint64_t used() const { return used_.load( std::memory_order_relaxed ); }
+  uint64_t bytes_evicted() const { return bytes_evicted_.load( std::memory_order_relaxed ); }
+  uint64_t evictions() const { return evictions_.load( std::memory_order_relaxed ); } // settles that had to evict
+
+  // One Reassembler's share of the budget, returned when the Account goes away.
+  class Account
+  {
+  public:
+    Account() = default;
+    explicit Account( std::shared_ptr<ReassemblyBudget> budget ) : budget_( std::move( budget ) ) {}
+    Account( Account&& other ) noexcept;
+    Account& operator=( Account&& other ) noexcept;
+    Account( const Account& other ) = delete;
+    Account& operator=( const Account& other ) = delete;
+    ~Account();
+
+    // Charge (or credit) the budget so that this account holds `pending` bytes. Returns how many
+    // of them the budget could not grant; the caller must evict that many.
+    uint64_t settle( uint64_t pending );
+
+    bool active() const { return budget_ != nullptr; }
+    uint64_t charged() const { return charged_; }
+
+  private:
+    std::shared_ptr<ReassemblyBudget> budget_ {};
+    uint64_t charged_ { 0 };
+  };
+
+private:
+  uint64_t charge( uint64_t bytes ); // returns how many bytes were granted
+  void credit( uint64_t bytes );
+
+  uint64_t limit_;
+  std::atomic<uint64_t> used_ { 0 };
+  std::atomic<uint64_t> bytes_evicted_ { 0 };
+  std::atomic<uint64_t> evictions_ { 0 };
+};
@@ -0,0 +1,67 @@
+#include "retransmission_queue.hh"
+
+#include <utility>
+
+using namespace std;
+
+void RetransmissionQueue::push_back( Segment&& segment )
+{
+  if ( size_ == ring_.size() ) {
+    // 环满了：按从旧到新的顺序搬进两倍大小的新环，head 归零
+    pmr::vector<Segment> bigger( ring_.empty() ? initial_capacity : 2 * ring_.size(), ring_.get_allocator() );
+    for ( size_t i = 0; i < size_; i++ ) {
+      bigger[i] = move( ( *this )[i] );
+    }
+    ring_ = move( bigger );
+    head_ = 0;
+  }
+  ring_[( head_ + size_ ) & ( ring_.size() - 1 )] = move( segment );
+  size_++;
+}
+
+size_t RetransmissionQueue::acknowledged( uint64_t ackno ) const
+{
+  // 各段首尾相接、序号递增，二分找到第一个 end 超过 ackno 的段
+  size_t low = 0;
+  size_t high = size_;
+  while ( low < high ) {
+    const size_t mid = low + ( high - low ) / 2;
+    if ( ( *this )[mid].end <= ackno ) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return low;
+}
+
+void RetransmissionQueue::pop_front( size_t n )
+{
+  head_ = ( head_ + n ) & ( ring_.size() - 1 );
+  size_ -= n;
+}
+
+uint64_t RetransmissionQueue::sack( uint64_t left, uint64_t right )
+{
+  // 二分找到第一个 end 超过 left 的段，它要是从 left 之前开始就只被覆盖了一部分，不算
+  size_t i = acknowledged( left );
+  if ( i < size_ && ( *this )[i].seqno < left ) {
+    i++;
+  }
+  uint64_t covered = 0;
+  for ( ; i < size_ && ( *this )[i].end <= right; i++ ) {
+    Segment& segment = ( *this )[i];
+    if ( not segment.sacked ) {
+      segment.sacked = true;
+      covered += segment.end - segment.seqno;
+    }
+  }
+  return covered;
+}
+
+void RetransmissionQueue::clear_sacks()
+{
+  for ( size_t i = 0; i < size_; i++ ) {
+    ( *this )[i].sacked = false;
+  }
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+/*
+ * The segments a TCPSender has sent but not had acknowledged yet, oldest first, in a ring buffer.
+ * Each is only a descriptor: the payload bytes stay in the sender's stream until they are acknowledged.
+ *
+ * Segments are only ever added at the back and acknowledged from the front, and their sequence
+ * ranges are contiguous and increasing, so a cumulative ACK is handled with a binary search for
+ * the first segment it doesn't cover (acknowledged()) and an O(1) advance of the front (pop_front()).
+ * Nothing is shifted; the ring doubles when it is full.
+ */
+class RetransmissionQueue
+{
+public:
+  struct Segment
+  {
+    uint64_t seqno {};   // absolute sequence number of the segment's first sequence number
+    uint64_t end {};     // absolute sequence number just past it
+    uint64_t sent_at {}; // the sender's clock (ms) when it was last transmitted
+    bool SYN {};
+    bool FIN {};
+    bool retransmitted {}; // by Karn's algorithm, its ACK can't be used as an RTT sample
+    uint64_t delivered {};    // what had been acknowledged when it was last transmitted...
+    uint64_t delivered_at {}; // ...and when that was (for a delivery rate sample once it is acknowledged)
+    bool sacked {};           // the receiver has it (a SACK block covers it), so it needn't be retransmitted
+    uint64_t recovery {};     // the sender's recovery episode in which it was last retransmitted, if any
+
+    uint64_t payload_size() const { return end - seqno - SYN - FIN; }
+  };
+
+  explicit RetransmissionQueue( std::pmr::memory_resource* arena = std::pmr::get_default_resource() )
+    : ring_( arena )
+  {}
+
+  bool empty() const { return size_ == 0; }
+  size_t size() const { return size_; }
+
+  Segment& operator[]( size_t i ) { return ring_[( head_ + i ) & ( ring_.size() - 1 )]; }
+  const Segment& operator[]( size_t i ) const { return ring_[( head_ + i ) & ( ring_.size() - 1 )]; }
+  Segment& front() { return ( *this )[0]; }
+  Segment& back() { return ( *this )[size_ - 1]; }
+
+  void push_back( Segment&& segment );
+
+  // How many segments, from the front, does the absolute `ackno` cover completely?
+  size_t acknowledged( uint64_t ackno ) const;
+
+  // Forget the first `n` segments.
+  void pop_front( size_t n );
+
+  // Mark the segments that lie entirely within the absolute range [left, right) as SACKed.
+  // Returns how many sequence numbers were newly covered.
+  uint64_t sack( uint64_t left, uint64_t right );
+
+  // Forget every SACK mark (the receiver is allowed to discard data it has SACKed).
+  void clear_sacks();
+
+private:
+  static constexpr size_t initial_capacity = 16;
+  std::pmr::vector<Segment> ring_; // its size is always zero or a power of two
+  size_t head_ { 0 };
+  size_t size_ { 0 };
+};
@@ -0,0 +1,185 @@
+#include "spsc_byte_stream.hh"
+
+#include "exception.hh"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+using namespace std;
+
+SPSCByteStream::SPSCByteStream( uint64_t capacity, bool wakeup_fds ) : capacity_( capacity ), ring_( capacity )
+{
+  if ( wakeup_fds ) {
+    readable_fd_.emplace( CheckSystemCall( "eventfd", eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC ) ) );
+    writable_fd_.emplace( CheckSystemCall( "eventfd", eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC ) ) );
+  }
+}
+
+void SPSCByteStream::signal( optional<FileDescriptor>& fd )
+{
+  if ( fd.has_value() ) {
+    const uint64_t one = 1;
+    CheckSystemCall( "write", static_cast<int>( ::write( fd->fd_num(), &one, sizeof( one ) ) ) );
+  }
+}
+
+void SPSCByteStream::drain( optional<FileDescriptor>& fd )
+{
+  if ( fd.has_value() ) {
+    uint64_t count {};
+    if ( ::read( fd->fd_num(), &count, sizeof( count ) ) < 0 and errno != EAGAIN ) {
+      throw unix_error { "read" };
+    }
+  }
+}
+
+void SPSCByteStream::set_error()
+{
+  error_.store( true, memory_order_release );
+  signal( readable_fd_ );
+  signal( writable_fd_ );
+}
+
+void SPSCWriter::push( string_view data )
+{
+  const auto space = reserve( data.size() );
+  if ( space.empty() ) { // full (or no capacity at all): data() is null, which memcpy must not see
+    return;
+  }
+  memcpy( space.data(), data.data(), space.size() );
+  commit( space.size() );
+}
+
+span<char> SPSCWriter::reserve( uint64_t len )
+{
+  reserved_ = min( len, available_capacity() );
+  if ( reserved_ == 0 ) {
+    return {};
+  }
+  // the ring is mirrored, so the free space is contiguous even when it wraps
+  return { ring_.data() + pushed_.load( memory_order_relaxed ) % ring_.size(), reserved_ };
+}
+
+void SPSCWriter::commit( uint64_t len )
+{
+  if ( len > reserved_ ) {
+    throw runtime_error( "SPSCWriter::commit() called with more bytes than were reserved" );
+  }
+  reserved_ = 0;
+  if ( len == 0 ) {
+    return;
+  }
+
+  const uint64_t before = pushed_.load( memory_order_relaxed );
+  pushed_.store( before + len, memory_order_release ); // publishes the bytes written above
+
+  if ( readable_fd_.has_value() ) {
+    // Only wake the reader if the buffer was empty: that is the only state it sleeps in. The fence
+    // pairs with the one in pop() so that either the reader sees our bytes or we see it drained them.
+    atomic_thread_fence( memory_order_seq_cst );
+    if ( popped_.load( memory_order_acquire ) == before ) {
+      signal( readable_fd_ );
+    }
+  }
+}
+
+void SPSCWriter::close()
+{
+  closed_.store( true, memory_order_release );
+  signal( readable_fd_ );
+}
+
+bool SPSCWriter::is_closed() const
+{
+  return closed_.load( memory_order_relaxed );
+}
+
+uint64_t SPSCWriter::available_capacity() const
+{
+  return capacity_ - ( pushed_.load( memory_order_relaxed ) - popped_.load( memory_order_acquire ) );
+}
+
+uint64_t SPSCWriter::bytes_pushed() const
+{
+  return pushed_.load( memory_order_relaxed );
+}
+
+string_view SPSCReader::peek() const
+{
+  const uint64_t popped = popped_.load( memory_order_relaxed );
+  const uint64_t buffered = pushed_.load( memory_order_acquire ) - popped;
+  if ( buffered == 0 ) {
+    return {};
+  }
+  return { ring_.data() + popped % ring_.size(), buffered };
+}
+
+void SPSCReader::pop( uint64_t len )
+{
+  const uint64_t popped = popped_.load( memory_order_relaxed );
+  const uint64_t n = min( len, pushed_.load( memory_order_acquire ) - popped );
+  if ( n == 0 ) {
+    return;
+  }
+  popped_.store( popped + n, memory_order_release ); // hands the space back to the writer
+
+  if ( writable_fd_.has_value() ) {
+    // Only wake the writer if the buffer was full (see SPSCWriter::commit).
+    atomic_thread_fence( memory_order_seq_cst );
+    if ( pushed_.load( memory_order_acquire ) - popped == capacity_ ) {
+      signal( writable_fd_ );
+    }
+  }
+}
+
+bool SPSCReader::is_finished() const
+{
+  // closed_ is stored after the final push, so once it is seen, pushed_ is final too
+  return closed_.load( memory_order_acquire ) and bytes_buffered() == 0;
+}
+
+uint64_t SPSCReader::bytes_buffered() const
+{
+  return pushed_.load( memory_order_acquire ) - popped_.load( memory_order_relaxed );
+}
+
+uint64_t SPSCReader::bytes_popped() const
+{
+  return popped_.load( memory_order_relaxed );
+}
+
+SPSCReader& SPSCByteStream::reader()
+{
+  static_assert( sizeof( SPSCReader ) == sizeof( SPSCByteStream ),
+                 "Please add member variables to the SPSCByteStream base, not the SPSCReader." );
+
+  return static_cast<SPSCReader&>( *this ); // NOLINT(*-downcast)
+}
+
+const SPSCReader& SPSCByteStream::reader() const
+{
+  static_assert( sizeof( SPSCReader ) == sizeof( SPSCByteStream ),
+                 "Please add member variables to the SPSCByteStream base, not the SPSCReader." );
+
+  return static_cast<const SPSCReader&>( *this ); // NOLINT(*-downcast)
+}
+
+SPSCWriter& SPSCByteStream::writer()
+{
+  static_assert( sizeof( SPSCWriter ) == sizeof( SPSCByteStream ),
+                 "Please add member variables to the SPSCByteStream base, not the SPSCWriter." );
+
+  return static_cast<SPSCWriter&>( *this ); // NOLINT(*-downcast)
+}
+
+const SPSCWriter& SPSCByteStream::writer() const
+{
+  static_assert( sizeof( SPSCWriter ) == sizeof( SPSCByteStream ),
+                 "Please add member variables to the SPSCByteStream base, not the SPSCWriter." );
+
+  return static_cast<const SPSCWriter&>( *this ); // NOLINT(*-downcast)
+}
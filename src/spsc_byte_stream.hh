@@ -0,0 +1,103 @@
+#pragma once
+
+#include "file_descriptor.hh"
+#include "mirrored_buffer.hh"
+
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+
+class SPSCReader;
+class SPSCWriter;
+
+/*
+ * A ByteStream whose Writer and Reader halves may be used from two different threads
+ * (exactly one thread writing and one thread reading), without locks.
+ *
+ * The bytes live in a mirrored ring buffer (see MirroredBuffer). The writer owns the
+ * count of bytes pushed and the reader owns the count of bytes popped; each publishes
+ * its counter with a release store and reads the other's with an acquire load, so the
+ * bytes behind a counter are always visible to the thread that observes it.
+ *
+ * With `wakeup_fds` set, the stream also owns two eventfds so that each thread can
+ * sleep in poll() (or an EventLoop rule) until the other side makes progress:
+ *   - readable_fd() is signalled when the buffer goes from empty to non-empty, or on close/error
+ *   - writable_fd() is signalled when the buffer goes from full to non-full
+ * After waking up, call clear_wakeup() on the same half before checking the stream again.
+ */
+class SPSCByteStream
+{
+public:
+  explicit SPSCByteStream( uint64_t capacity, bool wakeup_fds = false );
+
+  // Shared between threads: neither copyable nor movable
+  SPSCByteStream( const SPSCByteStream& other ) = delete;
+  SPSCByteStream& operator=( const SPSCByteStream& other ) = delete;
+  SPSCByteStream( SPSCByteStream&& other ) = delete;
+  SPSCByteStream& operator=( SPSCByteStream&& other ) = delete;
+  ~SPSCByteStream() = default;
+
+  // Access the Reader and Writer interfaces (the Reader on the consumer thread, the Writer on the producer)
+  SPSCReader& reader();
+  const SPSCReader& reader() const;
+  SPSCWriter& writer();
+  const SPSCWriter& writer() const;
+
+  void set_error(); // Signal that the stream suffered an error (either thread).
+  bool has_error() const { return error_.load( std::memory_order_acquire ); }
+
+  // The wakeup eventfds (only present if constructed with `wakeup_fds`)
+  std::optional<FileDescriptor>& readable_fd() { return readable_fd_; }
+  std::optional<FileDescriptor>& writable_fd() { return writable_fd_; }
+
+protected:
+  // Please add any additional state to the SPSCByteStream here, and not to the Writer and Reader interfaces.
+  static constexpr size_t cache_line = 64;
+
+  uint64_t capacity_;
+  MirroredBuffer ring_;
+  std::optional<FileDescriptor> readable_fd_ {};
+  std::optional<FileDescriptor> writable_fd_ {};
+
+  alignas( cache_line ) std::atomic<uint64_t> pushed_ { 0 }; // written only by the producer
+  std::atomic<bool> closed_ { false };                       // written only by the producer
+  std::atomic<bool> error_ { false };
+  uint64_t reserved_ { 0 };                                  // producer-private
+
+  alignas( cache_line ) std::atomic<uint64_t> popped_ { 0 }; // written only by the consumer
+
+  static void signal( std::optional<FileDescriptor>& fd );
+  static void drain( std::optional<FileDescriptor>& fd );
+};
+
+class SPSCWriter : public SPSCByteStream
+{
+public:
+  void push( std::string_view data ); // Copy as much of `data` into the stream as available capacity allows.
+  void close();                       // Signal that the stream has reached its ending; nothing more is written.
+
+  // Zero-copy writes, as in Writer::reserve/commit
+  std::span<char> reserve( uint64_t len );
+  void commit( uint64_t len );
+
+  bool is_closed() const;              // Has the stream been closed?
+  uint64_t available_capacity() const; // How many bytes can be pushed to the stream right now?
+  uint64_t bytes_pushed() const;       // Total number of bytes cumulatively pushed to the stream
+
+  void clear_wakeup() { drain( writable_fd_ ); } // Consume a pending writable_fd() wakeup
+};
+
+class SPSCReader : public SPSCByteStream
+{
+public:
+  std::string_view peek() const; // Peek at every byte currently buffered (always one contiguous view)
+  void pop( uint64_t len );      // Remove `len` bytes from the buffer
+
+  bool is_finished() const;        // Is the stream finished (closed and fully popped)?
+  uint64_t bytes_buffered() const; // Number of bytes currently buffered (pushed and not popped)
+  uint64_t bytes_popped() const;   // Total number of bytes cumulatively popped from stream
+
+  void clear_wakeup() { drain( readable_fd_ ); } // Consume a pending readable_fd() wakeup
+};
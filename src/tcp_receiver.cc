@@ -2,6 +2,7 @@
 #include "byte_stream.hh"
 #include "tcp_receiver_message.hh"
 #include "wrapping_integers.hh"
+#include <algorithm>
 #include <cstdint>
 #include <utility>
 
@@ -16,10 +17,21 @@ void TCPReceiver::receive( TCPSenderMessage message )
   }
   // 这里多考虑的是可能最开始的segment来的没有SYN，那就不能接收，必须先来SYN字段的，给了zero_point信息过后才能接收
   if ( message.SYN && !zero_point.has_value() ) {
+    sack_permitted_ = message.SACK_permitted;
+    window_shift_ = message.window_scale.has_value() ? window_scale_.value_or( 0 ) : 0;
+    ts_recent_ = timestamps_ ? message.timestamp : nullopt;
     reassembler_.insert( message.seqno.unwrap( message.seqno, next_bytes ), message.payload, message.FIN );
     zero_point = move( message.seqno );
   } else if ( zero_point.has_value() ) { // 这里-1特别关键，因为syn的原因，转换为stream index
-    reassembler_.insert( message.seqno.unwrap( zero_point.value(), next_bytes ) - 1, message.payload, message.FIN );
+    const uint64_t seqno = message.seqno.unwrap( zero_point.value(), next_bytes );
+    if ( !check_timestamp( message, seqno, next_bytes ) ) {
+      return;
+    }
+    const uint64_t index = seqno - 1;
+    if ( index > writer().bytes_pushed() && !message.payload.empty() ) {
+      latest_index_ = index; // 接不上，会存在reassembler里
+    }
+    reassembler_.insert( index, message.payload, message.FIN );
   }
   // 这里是得到最新的next_bytes也就是first_unassembled
   // index，它的值来源于当前pushed的数量再加上最开始的SYN，以及可能的结束的fin
@@ -27,11 +39,108 @@ void TCPReceiver::receive( TCPSenderMessage message )
   next_bytes = writer().is_closed() ? writer().bytes_pushed() + 2 : writer().bytes_pushed() + 1;
 }
 
+void TCPReceiver::receive_batch( span<TCPSenderMessage> messages )
+{
+  // 和逐个 receive 的处理一样，只是把换算好 index 的 payload 攒起来交给 insert_batch 一次处理
+  batch_.clear();
+  bool reset = false;
+  uint64_t ackno = next_bytes; // 批里的段还没重组，按已经接上的段估计每个段到达时的ackno，给TS.Recent用
+  for ( auto& message : messages ) {
+    if ( message.RST ) {
+      reset = true;
+      break;
+    }
+    if ( message.SYN && !zero_point.has_value() ) {
+      zero_point = message.seqno;
+      sack_permitted_ = message.SACK_permitted;
+      window_shift_ = message.window_scale.has_value() ? window_scale_.value_or( 0 ) : 0;
+      ts_recent_ = timestamps_ ? message.timestamp : nullopt;
+      ackno = message.sequence_length();
+      batch_.push_back( { 0, move( message.payload ), message.FIN } );
+    } else if ( zero_point.has_value() ) {
+      const uint64_t seqno = message.seqno.unwrap( zero_point.value(), next_bytes );
+      if ( !check_timestamp( message, seqno, ackno ) ) {
+        continue;
+      }
+      if ( seqno <= ackno ) {
+        ackno = max( ackno, seqno + message.sequence_length() );
+      }
+      const uint64_t index = seqno - 1;
+      if ( index > writer().bytes_pushed() && !message.payload.empty() ) {
+        latest_index_ = index;
+      }
+      batch_.push_back( { index, move( message.payload ), message.FIN } );
+    }
+  }
+  reassembler_.insert_batch( batch_ );
+  if ( reset ) {
+    reader().set_error();
+    return;
+  }
+  next_bytes = writer().is_closed() ? writer().bytes_pushed() + 2 : writer().bytes_pushed() + 1;
+}
+
+bool TCPReceiver::check_timestamp( const TCPSenderMessage& message, uint64_t seqno, uint64_t ackno )
+{
+  if ( !ts_recent_.has_value() || !message.timestamp.has_value() ) {
+    return true;
+  }
+  // PAWS：时间戳比TS.Recent还旧（按32位回绕比较），是很久以前的重复段，序号回绕以后可能正好落在窗口里
+  if ( static_cast<int32_t>( message.timestamp.value() - ts_recent_.value() ) < 0 ) {
+    return false;
+  }
+  // 只有从上次ack的位置（或者之前）开始的段才更新TS.Recent，乱序到达的段不算，这样回显的是推进ackno的那个段的时间
+  if ( seqno <= ackno ) {
+    ts_recent_ = message.timestamp;
+  }
+  return true;
+}
+
+void TCPReceiver::enable_window_scaling()
+{
+  // 最小的移位，让16位的窗口字段能表示整个容量；RFC 7323规定最多14位
+  uint8_t shift = 0;
+  while ( shift < 14 && ( writer().available_capacity() >> shift ) > UINT16_MAX ) {
+    shift++;
+  }
+  window_scale_ = shift;
+}
+
+uint16_t TCPReceiver::unscaled_window_size() const
+{
+  return static_cast<uint16_t>( min<uint64_t>( writer().available_capacity(), UINT16_MAX ) );
+}
+
 TCPReceiverMessage TCPReceiver::send() const
 {
-  return TCPReceiverMessage { zero_point.has_value() ? Wrap32::wrap( next_bytes, zero_point.value() ) : zero_point,
-                              static_cast<uint16_t>( writer().available_capacity() > UINT16_MAX
-                                                       ? UINT16_MAX
-                                                       : writer().available_capacity() ),
-                              reader().has_error() };
+  // 协商了窗口缩放的话，通告的是右移过的窗口（向下取整，不会多报）
+  TCPReceiverMessage msg { zero_point.has_value() ? Wrap32::wrap( next_bytes, zero_point.value() ) : zero_point,
+                           static_cast<uint16_t>( min<uint64_t>( writer().available_capacity() >> window_shift_,
+                                                                 UINT16_MAX ) ),
+                           reader().has_error() };
+  msg.timestamp_echo = ts_recent_;
+  if ( !sack_ || !sack_permitted_ || reassembler_.bytes_pending() == 0 ) {
+    return msg;
+  }
+  // SACK块（RFC 2018）：第一个是最近收到的段所在的区间，其余的按序号从小到大，序号是stream index加上SYN的1
+  const auto block = [&]( const Reassembler::Range& range ) {
+    return pair { Wrap32::wrap( range.first + 1, zero_point.value() ),
+                  Wrap32::wrap( range.second + 1, zero_point.value() ) };
+  };
+  const auto latest = reassembler_.pending_range( latest_index_ );
+  if ( latest.has_value() ) {
+    msg.sack.push_back( block( *latest ) );
+  }
+  // 带时间戳的话选项只放得下三个SACK块
+  const size_t max_blocks = ts_recent_.has_value() ? TCPReceiverMessage::MAX_SACK_BLOCKS_WITH_TIMESTAMPS
+                                                   : TCPReceiverMessage::MAX_SACK_BLOCKS;
+  for ( const auto& range : reassembler_.pending_ranges( max_blocks ) ) {
+    if ( msg.sack.size() == max_blocks ) {
+      break;
+    }
+    if ( range != latest ) {
+      msg.sack.push_back( block( range ) );
+    }
+  }
+  return msg;
 }
@@ -4,6 +4,10 @@
 #include "tcp_receiver_message.hh"
 #include "tcp_sender_message.hh"
 #include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <vector>
 
 class TCPReceiver
 {
@@ -17,11 +21,37 @@ public:
    */
   void receive( TCPSenderMessage message );
 
+  // Receive several messages at once (e.g. all those read in one wakeup), reassembling them in one batch.
+  void receive_batch( std::span<TCPSenderMessage> messages );
+
   // The TCPReceiver sends TCPReceiverMessages to the peer's TCPSender.
+  // (With SACK blocks for what the Reassembler holds, if SACK is enabled and the peer's SYN said it
+  // understands them too.)
   TCPReceiverMessage send() const;
 
+  // Offer window scaling (RFC 7323) with the smallest shift that lets the window cover the whole
+  // capacity. If the peer's SYN carries a window scale too, send() then advertises the window
+  // shifted right by window_scale(), so a capacity above 64 KiB can be used.
+  // (off by default: the window is then capped at UINT16_MAX)
+  void enable_window_scaling();
+  std::optional<uint8_t> window_scale() const { return window_scale_; } // to offer on our SYN
+  uint16_t unscaled_window_size() const; // the window for our SYN, which is never scaled
+
+  // Use timestamps (RFC 7323) if the peer's SYN carries one: send() then echoes the timestamp of the
+  // segment that last advanced the ackno, and segments with an older timestamp than that are
+  // dropped as old duplicates (PAWS) -- which their sequence numbers can't show once they wrap.
+  // (off by default)
+  void enable_timestamps() { timestamps_ = true; }
+
+  // Send SACK blocks (RFC 2018) if the peer's SYN permits them (off by default)
+  void enable_sack() { sack_ = true; }
+
   // Access the output (only Reader is accessible non-const)
   const Reassembler& reassembler() const { return reassembler_; }
+  void set_reassembly_budget( std::shared_ptr<ReassemblyBudget> budget )
+  {
+    reassembler_.set_budget( std::move( budget ) );
+  }
   Reader& reader() { return reassembler_.reader(); }
   const Reader& reader() const { return reassembler_.reader(); }
   const Writer& writer() const { return reassembler_.writer(); }
@@ -30,4 +60,13 @@ private:
   Reassembler reassembler_;
   std::optional<Wrap32> zero_point {};
   uint64_t next_bytes { 0 }; // i.e ackno or first unassembled index
+  bool sack_ { false };           // 我们的SYN也提出了SACK
+  bool sack_permitted_ { false }; // 对方的SYN带了SACK-permitted，ack里可以带SACK块
+  uint64_t latest_index_ { 0 };   // 最近一个没能按序写出的段的stream index，它所在的区间作为第一个SACK块
+  std::optional<uint8_t> window_scale_ {}; // 我们在SYN里提出的窗口缩放
+  uint8_t window_shift_ { 0 };             // 对方的SYN也带了窗口缩放，通告的窗口才右移这么多位
+  bool timestamps_ { false };
+  std::optional<uint32_t> ts_recent_ {}; // TS.Recent：要回显的时间戳，对方的SYN带了时间戳才有
+  bool check_timestamp( const TCPSenderMessage& message, uint64_t seqno, uint64_t ackno ); // PAWS，更新TS.Recent
+  std::vector<Reassembler::Segment> batch_ {}; // reused by receive_batch
 };
@@ -3,9 +3,11 @@
 #include "tcp_config.hh"
 #include "tcp_sender_message.hh"
 #include "wrapping_integers.hh"
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
+#include <optional>
 #include <utility>
-#include <vector>
 
 using namespace std;
 // How many sequence numbers are outstanding?
@@ -19,34 +21,98 @@ uint64_t TCPSender::consecutive_retransmissions() const
   return dup_count;
 }
 
+uint64_t TCPSender::fast_retransmissions() const
+{
+  return fast_retransmissions_;
+}
+
+uint64_t TCPSender::max_payload_size() const
+{
+  // 时间戳选项（连同对齐用的两个NOP）占12字节，和接收方的SACK块一起从MSS里扣掉
+  constexpr uint64_t timestamp_option_length = 12;
+  const uint64_t options = ( timestamps_ ? timestamp_option_length : 0 ) + receiver_options_length_;
+  return mss_ > options ? mss_ - options : mss_;
+}
+
+uint64_t TCPSender::mss() const
+{
+  return mss_;
+}
+
+TCPSender::RTTEstimate TCPSender::rtt_estimate() const
+{
+  return { srtt8_ >> 3, rttvar4_ >> 2, RTO_ms_, rtt_samples_ };
+}
+
+void TCPSender::enable_rtt_estimation( uint64_t min_RTO_ms, uint64_t max_RTO_ms )
+{
+  adaptive_RTO_ = true;
+  min_RTO_ms_ = min_RTO_ms;
+  max_RTO_ms_ = max( min_RTO_ms, max_RTO_ms );
+  RTO_ms_ = clamp( RTO_ms_, min_RTO_ms_, max_RTO_ms_ );
+}
+
+void TCPSender::sample_rtt( uint64_t rtt_ms )
+{
+  if ( rtt_samples_ == 0 ) {
+    // 第一个样本：SRTT = R，RTTVAR = R/2
+    srtt8_ = rtt_ms << 3;
+    rttvar4_ = rtt_ms << 1;
+  } else {
+    // RTTVAR = 3/4 RTTVAR + 1/4 |SRTT - R|，SRTT = 7/8 SRTT + 1/8 R（RTTVAR要用旧的SRTT算）
+    const uint64_t srtt = srtt8_ >> 3;
+    rttvar4_ = rttvar4_ - ( rttvar4_ >> 2 ) + ( srtt > rtt_ms ? srtt - rtt_ms : rtt_ms - srtt );
+    srtt8_ = srtt8_ - ( srtt8_ >> 3 ) + rtt_ms;
+  }
+  rtt_samples_++;
+  // RTO = SRTT + max(G, 4 RTTVAR)，时钟粒度G是1ms
+  RTO_ms_ = clamp( ( srtt8_ >> 3 ) + max<uint64_t>( 1, rttvar4_ ), min_RTO_ms_, max_RTO_ms_ );
+}
+
 void TCPSender::push( const TransmitFunction& transmit )
 {
   TCPSenderMessage sendMsg;
 
-  if ( ( SYN || reader().bytes_buffered() || ( writer().is_closed() && FIN ) )
-       && NextByte2Sent - LastByteAcked < rwnd ) {
+  // 重复ack、部分确认或者SACK块说明有段丢了，不等超时先重传
+  if ( retransmit_lost_ ) {
+    retransmit_lost_ = false;
+    retransmit_lost( transmit );
+  }
+
+  if ( ( SYN || unsent() || ( writer().is_closed() && FIN ) )
+       && can_send() ) {
     sendMsg.SYN = SYN;
+    sendMsg.SACK_permitted = SYN && sack_;
+    sendMsg.timestamp = timestamp();
     // 在这里要物尽其用的尽可能把数据加入放到一个segment里面，保证window有空和buffer有内容即可,并且大小不能超过设定payload最大值
     do {
       // 寻找能够加入的最大数据量，每次产生一个能够发送的segment
       sendMsg.FIN = writer().is_closed();
+      sendMsg.payload = input_.buffer_pool() ? input_.buffer_pool()->acquire( max_payload_size() ) : "";
       FindMaxSeg( sendMsg );
-      // 发送这个sendMsg
+      if ( paced() ) {
+        pacing_credit_ -= static_cast<int64_t>( sendMsg.sequence_length() * 1000 );
+      }
+      // 发送这个segment。payload发完就不用留着了：transButUnack只记序号，重传时再从input_里保留的字节取
       transmit( sendMsg );
-      // 传送过了，需要清空sendMsg的内容
-      sendMsg.payload.clear();
+      release( move( sendMsg ) );
       SYN = false;
-    } while ( reader().bytes_buffered() != 0 && NextByte2Sent - LastByteAcked < rwnd );
+    } while ( unsent() != 0 && can_send() );
   } else if ( rwnd == 0 && !has_trans_win0_ ) {
     // 特殊情况rwnd为0，那么直接transmit一个byte
     sendMsg.seqno = Wrap32::wrap( NextByte2Sent, isn_ );
-    if ( !reader().is_finished() ) {
-      sendMsg.payload = reader().peek().substr( 0, 1 );
-      input_.reader().pop( 1 );
-    } else {
+    sendMsg.timestamp = timestamp();
+    if ( unsent() != 0 ) {
+      copy_payload( retained_, 1, sendMsg.payload );
+      retained_++;
+    } else if ( writer().is_closed() && FIN ) {
       sendMsg.FIN = true;
+      FIN = false;
+    } else {
+      return; // 没有可以发的
     }
-    transButUnack.emplace_back( sendMsg );
+    transButUnack.push_back(
+      { NextByte2Sent, NextByte2Sent + 1, now_ms_, false, sendMsg.FIN, false, LastByteAcked, delivered_at_ms_ } );
     NextByte2Sent++;
     transmit( sendMsg );
     has_trans_win0_ = true;
@@ -55,45 +121,102 @@ void TCPSender::push( const TransmitFunction& transmit )
 
 TCPSenderMessage TCPSender::make_empty_message() const
 {
-  return TCPSenderMessage { .seqno = Wrap32::wrap( NextByte2Sent, isn_ ), .RST = writer().has_error() };
+  return TCPSenderMessage {
+    .seqno = Wrap32::wrap( NextByte2Sent, isn_ ), .RST = writer().has_error(), .timestamp = timestamp() };
 }
 
-void TCPSender::receive( const TCPReceiverMessage& msg )
+void TCPSender::receive( const TCPReceiverMessage& msg, bool carries_data )
 {
   if ( msg.RST ) { // 遇到异常情况
     writer().set_error();
     writer().close();
     return;
   }
-  rwnd = msg.window_size;
+  const uint64_t previous_window = rwnd;
+  rwnd = static_cast<uint64_t>( msg.window_size ) << window_shift_;
+  // 发送缓冲跟着窗口长：一个窗口的数据在途（确认前都留在input_里），再留一个窗口给应用接着写
+  if ( max_send_capacity_ != 0 ) {
+    input_.writer().grow_capacity( min( max_send_capacity_, 2 * rwnd ) );
+  }
   // 对于没有ackno的，就是更新window信息：
   if ( not msg.ackno.has_value() ) {
     // 清空上一次的时间积累
     accumulated_time = 0;
-    // 复原RTO_ms_
-    RTO_ms_ = initial_RTO_ms_;
+    // 复原RTO_ms_（自适应RTO的时候保持原样，没有新样本就不变）
+    if ( not adaptive_RTO_ ) {
+      RTO_ms_ = initial_RTO_ms_;
+    }
     return;
   }
   uint64_t ackno = msg.ackno->unwrap( isn_, LastByteAcked );
+  // 恢复中新的SACK块可能又暴露出新的洞
+  if ( update_scoreboard( msg, ackno ) && in_recovery_ ) {
+    retransmit_lost_ = true;
+  }
+  // 重复ack：没带数据、窗口没变、ackno没前进，而且还有没确认的段（RFC 5681）。
+  // 第三个就快速重传；NewReno：已经确认过recover_之前的才能再次进入，避免一次丢包多次重传
+  if ( ackno == LastByteAcked && not carries_data && rwnd == previous_window && rwnd != 0
+       && not transButUnack.empty() ) {
+    if ( ++dup_acks_ == 3 && fast_retransmit_ && not in_recovery_ && LastByteAcked >= recover_ ) {
+      in_recovery_ = true;
+      recover_ = NextByte2Sent;
+      recovery_episode_++;
+      retransmit_lost_ = true;
+      first_hole_ = true;
+      if ( cc_ ) {
+        cc_->on_loss( NextByte2Sent - LastByteAcked, now_ms_ );
+      }
+    }
+    return;
+  }
   // 查看是否是冗余ack，以及查看是否是超过了当前sent的packet的bytes，这种直接忽略
   if ( ackno <= LastByteAcked
        || ackno > NextByte2Sent ) { // 如果是之前已经应答了的或者说ack了一个还没有发送的序列，那么省略掉
     return;
   }
-  // 到了这里，说明是没有冗余ack，利用累计确认原则，进行清除,我这里遍历去查找，后续可能会改成set采用log算法查找（但不见得更优）
-  vector<TCPSenderMessage>::iterator iter = transButUnack.begin();
-  while ( iter != transButUnack.end()
-          && iter->seqno.unwrap( isn_, LastByteAcked ) + iter->sequence_length() <= ackno )
-    iter++; // 出来的是刚好大于ack的，也就是没有被确认的
-  if ( iter != transButUnack.begin() ) {
-    transButUnack.erase( transButUnack.begin(), iter ); // 删除确认段之前的
+  // 到了这里，说明是没有冗余ack，利用累计确认原则，进行清除：队列里的段按序号递增，二分找出被完全确认的段数
+  const size_t acked = transButUnack.acknowledged( ackno );
+  if ( acked != 0 ) {
+    // 被确认的payload这时才从input_里pop掉。各段首尾相接，SYN只可能在第一段、FIN只可能在最后一段
+    const auto& first = transButUnack.front();
+    const auto& last = transButUnack[acked - 1];
+    const uint64_t acked_bytes = last.end - first.seqno - first.SYN - last.FIN;
+    // 用最新被确认的段测一个RTT，重传过的段不能用（Karn算法）。
+    // 自适应RTO没有样本的时候保持退避后的RTO，直到有一个没重传过的段被确认。
+    // 有时间戳就不用管这些：回显的TSval就是推进ackno的那个段（也可能是重传）发出的时刻
+    optional<uint64_t> rtt_ms = last.retransmitted ? nullopt : optional { now_ms_ - last.sent_at };
+    if ( timestamps_ and msg.timestamp_echo.has_value() ) {
+      rtt_ms = static_cast<uint32_t>( static_cast<uint32_t>( now_ms_ ) - msg.timestamp_echo.value() );
+    }
+    if ( adaptive_RTO_ and rtt_ms.has_value() ) {
+      sample_rtt( *rtt_ms );
+    } else if ( not adaptive_RTO_ ) {
+      RTO_ms_ = initial_RTO_ms_; // 复原RTO_ms_
+    }
+    input_.reader().pop( acked_bytes );
+    retained_ -= acked_bytes;
+    transButUnack.pop_front( acked ); // 删除确认段之前的，只移动队头
+    dup_acks_ = 0;
+    if ( in_recovery_ ) {
+      // 确认到recover_就退出恢复；部分确认说明下一个段也丢了（NewReno），马上重传它
+      in_recovery_ = ackno < recover_;
+      retransmit_lost_ = in_recovery_;
+    }
     dup_count = 0;                                      // 清空重传次数积累
     // 更新LastByteAcked
+    const uint64_t newly_acked = ackno - LastByteAcked;
     LastByteAcked = ackno;
+    if ( cc_ ) {
+      // 交付速率样本：最新确认的段发出以后（从当时最后一次确认算起）又确认了多少。
+      // 从最后一次确认而不是发送时刻算，补上一个洞以后的累计确认就不会显得特别快
+      const uint64_t interval = now_ms_ - last.delivered_at;
+      const optional<uint64_t> rate
+        = interval == 0 ? nullopt : optional { ( ackno - last.delivered ) * 1000 / interval };
+      cc_->on_ack( { newly_acked, NextByte2Sent - LastByteAcked, LastByteAcked, now_ms_, rtt_ms, rate } );
+    }
+    delivered_at_ms_ = now_ms_;
     // 清空上一次的时间积累
     accumulated_time = 0;
-    // 复原RTO_ms_
-    RTO_ms_ = initial_RTO_ms_;
     // 复原has_trans_win0
     if ( has_trans_win0_ )
       has_trans_win0_ = false;
@@ -102,6 +225,16 @@ void TCPSender::receive( const TCPReceiverMessage& msg )
 
 void TCPSender::tick( uint64_t ms_since_last_tick, const TransmitFunction& transmit )
 {
+  now_ms_ += ms_since_last_tick;
+  if ( paced() ) {
+    // 按pacing rate攒发送额度，最多攒两个段（或者一个tick）的量，然后把攒够额度的数据发出去
+    const auto earned = static_cast<int64_t>( cc_->pacing_rate() * ms_since_last_tick );
+    const auto cap = max<int64_t>( static_cast<int64_t>( 2 * mss_ * 1000 ), earned );
+    pacing_credit_ = min( pacing_credit_ + earned, cap );
+    if ( unsent() != 0 ) {
+      push( transmit );
+    }
+  }
   if ( not transButUnack.empty() ) {
     accumulated_time += ms_since_last_tick; // 更新目前累计时间
     if ( accumulated_time < RTO_ms_ ) {     // 没有超时
@@ -111,42 +244,155 @@ void TCPSender::tick( uint64_t ms_since_last_tick, const TransmitFunction& trans
     accumulated_time = 0;                        // 清空时间积累
     dup_count++;                                 // 重传次数增加
     RTO_ms_ = rwnd == 0 ? RTO_ms_ : 2 * RTO_ms_; // 倍增,对于rwnd为0 的时候不倍增时间
-    // 构造重传的message，也就是传transButUnack里面第一个元素即可，它有index用来填充
-    transmit( transButUnack[0] );
+    if ( adaptive_RTO_ ) {
+      RTO_ms_ = min( RTO_ms_, max_RTO_ms_ ); // 退避也不超过上限
+    }
+    // 窗口为0时的超时是在探测窗口，不是拥塞
+    if ( cc_ and rwnd != 0 ) {
+      cc_->on_rto( NextByte2Sent - LastByteAcked, now_ms_ );
+    }
+    // 超时就退出快速恢复，超时前发出去的段再收到重复ack也不快速重传
+    in_recovery_ = false;
+    retransmit_lost_ = false;
+    dup_acks_ = 0;
+    recover_ = NextByte2Sent;
+    recovery_episode_++;
+    if ( peer_sacks_ ) {
+      // 有SACK的话（和Linux一样）把没被SACK的段全当作丢了，之后每个ack都按窗口重传洞，直到确认到recover_。
+      // 最老的段都被SACK过，说明接收方把SACK过的数据丢掉了（RFC 2018允许），那记分板就不可信了
+      if ( transButUnack.front().sacked ) {
+        transButUnack.clear_sacks();
+      }
+      lost_end_ = NextByte2Sent;
+      in_recovery_ = true;
+    }
+    retransmit( 0, transmit );
+  }
+}
+
+void TCPSender::retransmit( size_t i, const TransmitFunction& transmit )
+{
+  // 构造重传的message：transButUnack里面第i个元素记着序号，payload从input_保留的字节里取
+  auto& segment = transButUnack[i];
+  segment.sent_at = now_ms_;
+  segment.retransmitted = true;
+  segment.delivered = LastByteAcked;
+  segment.delivered_at = delivered_at_ms_;
+  segment.recovery = recovery_episode_;
+  TCPSenderMessage msg { .seqno = Wrap32::wrap( segment.seqno, isn_ ),
+                         .SYN = segment.SYN,
+                         .FIN = segment.FIN,
+                         .RST = writer().has_error(),
+                         .SACK_permitted = segment.SYN && sack_,
+                         .timestamp = timestamp() };
+  if ( input_.buffer_pool() ) {
+    msg.payload = input_.buffer_pool()->acquire( segment.payload_size() );
+  }
+  // 绝对序号减去SYN占的1就是流里的下标，input_最前面是第bytes_popped()个字节
+  copy_payload( segment.seqno + segment.SYN - 1 - reader().bytes_popped(), segment.payload_size(), msg.payload );
+  transmit( msg );
+  release( move( msg ) );
+}
+
+void TCPSender::retransmit_lost( const TransmitFunction& transmit )
+{
+  if ( transButUnack.empty() ) {
+    return;
+  }
+  if ( not peer_sacks_ ) {
+    // 没有SACK（NewReno）：只知道最老的段丢了
+    retransmit( 0, transmit );
+    fast_retransmissions_++;
+    return;
+  }
+  // 最高的SACK之下没被SACK的段都是洞：这次恢复里还没重传过的，在途的（pipe）不超过窗口就重传，已经到了的一个也不重发。
+  // 部分确认本身不算丢包：补上洞以后的确认可能只是追上了还在路上的段
+  uint64_t in_network = pipe();
+  for ( size_t i = 0; i < transButUnack.size() && transButUnack[i].seqno < lost_end_; i++ ) {
+    const auto& segment = transButUnack[i];
+    if ( segment.sacked || segment.recovery == recovery_episode_ ) {
+      continue;
+    }
+    if ( in_network >= window() && not first_hole_ ) {
+      break;
+    }
+    first_hole_ = false;
+    in_network += segment.end - segment.seqno;
+    retransmit( i, transmit );
+    fast_retransmissions_++;
+  }
+}
+
+uint64_t TCPSender::pipe() const
+{
+  uint64_t in_network = 0;
+  for ( size_t i = 0; i < transButUnack.size(); i++ ) {
+    const auto& segment = transButUnack[i];
+    if ( not segment.sacked && ( segment.seqno >= lost_end_ || segment.recovery == recovery_episode_ ) ) {
+      in_network += segment.end - segment.seqno;
+    }
   }
+  return in_network;
+}
+
+bool TCPSender::update_scoreboard( const TCPReceiverMessage& msg, uint64_t ackno )
+{
+  if ( not sack_ || ackno > NextByte2Sent ) {
+    return false;
+  }
+  peer_sacks_ = peer_sacks_ || not msg.sack.empty();
+  uint64_t covered = 0;
+  for ( const auto& [left_seqno, right_seqno] : msg.sack ) {
+    const uint64_t left = left_seqno.unwrap( isn_, LastByteAcked );
+    const uint64_t right = right_seqno.unwrap( isn_, LastByteAcked );
+    // 不合法的，或者已经被累计确认的块不管
+    if ( left >= right || right > NextByte2Sent || left < max( ackno, LastByteAcked ) ) {
+      continue;
+    }
+    covered += transButUnack.sack( left, right );
+    lost_end_ = max( lost_end_, right );
+  }
+  return covered != 0;
 }
 
 // 根据当前情况来产生一个最大的segment能被发送
 void TCPSender::FindMaxSeg( TCPSenderMessage& sendMsg )
 {
-  // 条件就是不超过最大payload限制，不超过rwnd，然后不停从reader里面读取
-  // 有个最大的问题就是FIN的捎带，怎么带？它要占一个byte在rwnd里面，最开始就加入它吗？
-  auto peeked = reader().peek();
-  auto space = rwnd - NextByte2Sent + LastByteAcked;
-  // 新加入的能够完整存放，就直接一直存,能在这里处理完数据是最好的，也就是触发is_finished而退出，不然就要切割
-  while ( sendMsg.sequence_length() + peeked.size() <= space
-          && peeked.size() + sendMsg.payload.size() <= TCPConfig::MAX_PAYLOAD_SIZE && !peeked.empty() ) {
-    sendMsg.payload += peeked;
-    // 弹出加入的peek部分
-    input_.reader().pop( peeked.size() );
-    // 更新peeked
-    peeked = reader().peek();
-  }
-  // 退出来，检查是否已经把内容吸收完毕,否则需要切割
-  // 理一下思路：如果peek里面有内容，不能直接加入，可以切割，但是这里有细节，
-  // 没接收完成，因为目前已经占满或者有空，只是不够大，但是有FIN，那么FIN退出，加入peeked
-  if ( not peeked.empty() ) {
-    auto size = min( space - sendMsg.sequence_length() + sendMsg.FIN,
-                     TCPConfig::MAX_PAYLOAD_SIZE - sendMsg.payload.size() );
-    peeked = peeked.substr( 0, size ); // 多加入一位，由于FIN产生
-    sendMsg.payload += peeked;
-    input_.reader().pop( peeked.size() );
-    sendMsg.FIN = false;
-  }
+  // 条件就是不超过最大payload限制，不超过rwnd（SYN也占一个序号）。先算好长度，再一次拷贝出来
+  const uint64_t space = window() - NextByte2Sent + LastByteAcked;
+  const uint64_t len = min( { unsent(), max_payload_size(), space - sendMsg.SYN } );
+  // FIN的捎带：数据全部放进这个段、并且窗口里还有FIN的一个序号才带上
+  sendMsg.FIN = sendMsg.FIN && len == unsent() && sendMsg.SYN + len < space;
+  copy_payload( retained_, len, sendMsg.payload );
+  // 加入的部分留在input_里等确认，只是往后挪
+  retained_ += len;
   sendMsg.RST = writer().has_error();
   sendMsg.seqno = Wrap32::wrap( NextByte2Sent, isn_ );
-  transButUnack.emplace_back( sendMsg );
+  const uint64_t first = NextByte2Sent;
   NextByte2Sent += sendMsg.sequence_length();
   // 这个FIN的变量很关键，解决发送多个FIN的问题，因为发送了FIN后，可能会收到ACK，这个时候再次push，如果不设置这里，就会重复push一次FIN
   FIN = FIN ? !sendMsg.FIN : false;
+  transButUnack.push_back(
+    { first, NextByte2Sent, now_ms_, sendMsg.SYN, sendMsg.FIN, false, LastByteAcked, delivered_at_ms_ } );
+}
+
+void TCPSender::copy_payload( uint64_t offset, uint64_t len, string& payload ) const
+{
+  payload.reserve( payload.size() + len );
+  while ( len > 0 ) {
+    const auto view = reader().peek_at( offset ).substr( 0, len );
+    if ( view.empty() ) {
+      break;
+    }
+    payload += view;
+    offset += view.size();
+    len -= view.size();
+  }
+}
+
+void TCPSender::release( TCPSenderMessage&& msg )
+{
+  if ( input_.buffer_pool() ) {
+    input_.buffer_pool()->release( move( msg.payload ) );
+  }
 }
\ No newline at end of file
@@ -1,13 +1,18 @@
 #pragma once
 
 #include "byte_stream.hh"
+#include "congestion_control.hh"
+#include "retransmission_queue.hh"
+#include "tcp_config.hh"
 #include "tcp_receiver_message.hh"
 #include "tcp_sender_message.hh"
 
+#include <algorithm>
 #include <cstdint>
 #include <functional>
 #include <list>
 #include <memory>
+#include <memory_resource>
 #include <optional>
 #include <queue>
 #include <string>
@@ -17,28 +22,92 @@ class TCPSender
 {
 public:
   /* Construct TCP sender with given default Retransmission Timeout and possible ISN */
-  TCPSender( ByteStream&& input, Wrap32 isn, uint64_t initial_RTO_ms )
+  /* (its queue of outstanding segments is allocated from `arena`) */
+  TCPSender( ByteStream&& input,
+             Wrap32 isn,
+             uint64_t initial_RTO_ms,
+             std::pmr::memory_resource* arena = std::pmr::get_default_resource() )
     : input_( std::move( input ) ), isn_( isn ), initial_RTO_ms_( initial_RTO_ms ),RTO_ms_(initial_RTO_ms_)
+    , transButUnack( arena )
   {}
 
   /* Generate an empty TCPSenderMessage */
   TCPSenderMessage make_empty_message() const;
 
   /* Receive and process a TCPReceiverMessage from the peer's receiver */
-  void receive( const TCPReceiverMessage& msg );
+  /* (`carries_data` if it arrived with data, which keeps it from counting as a duplicate ACK) */
+  void receive( const TCPReceiverMessage& msg, bool carries_data = false );
 
   /* Type of the `transmit` function that the push and tick methods can use to send messages */
   using TransmitFunction = std::function<void( const TCPSenderMessage& )>;
 
   /* Push bytes from the outbound stream */
+  /* (first retransmitting what duplicate, partial or selective ACKs showed to be lost) */
   void push( const TransmitFunction& transmit );
 
   /* Time has passed by the given # of milliseconds since the last time the tick() method was called */
   void tick( uint64_t ms_since_last_tick, const TransmitFunction& transmit );
 
+  /* Adapt the RTO to measured round-trip times (RFC 6298), kept within [min_RTO_ms, max_RTO_ms] */
+  /* (off by default: the RTO then goes back to initial_RTO_ms on every new ACK) */
+  void enable_rtt_estimation( uint64_t min_RTO_ms, uint64_t max_RTO_ms );
+
+  /* Retransmit the oldest segment on the third duplicate ACK, and on each partial ACK until the */
+  /* loss is repaired (RFC 5681 fast retransmit, RFC 6582 NewReno), instead of waiting for the RTO */
+  /* (off by default: duplicate ACKs are then ignored) */
+  void enable_fast_retransmit() { fast_retransmit_ = true; }
+
+  /* Offer SACK on the SYN, and keep a scoreboard of the segments the receiver's SACK blocks cover: */
+  /* recovery then retransmits the holes below the highest SACKed segment, as fast as the window */
+  /* allows, and never what already arrived (RFC 2018, RFC 6675) */
+  /* (off by default; TCPPeer turns it off again if the peer's SYN doesn't offer SACK too) */
+  void enable_sack() { sack_ = true; }
+  void disable_sack() { sack_ = false; }
+
+  /* Take the receiver's windows to be shifted right by `shift` bits, as its SYN said (RFC 7323), */
+  /* once both SYNs carried a window scale; the window on the SYN itself is never scaled */
+  void set_window_scale( uint8_t shift ) { window_shift_ = shift; }
+
+  /* Grow the outbound stream's capacity to twice the receiver's window, up to `max_capacity`: sent bytes */
+  /* stay in the stream until acknowledged, so otherwise its initial capacity would bound the bytes in */
+  /* flight however large a window the receiver scales up to (off by default) */
+  void enable_send_buffer_autotuning( uint64_t max_capacity ) { max_send_capacity_ = max_capacity; }
+
+  /* Put our clock (TSval) on every segment, and take an RTT sample from the echo (TSecr) on every */
+  /* ACK of new data -- retransmitted segments included, which Karn's algorithm has to skip (RFC 7323) */
+  /* (off by default; TCPPeer turns it off again if the peer's SYN carries no timestamp) */
+  void enable_timestamps() { timestamps_ = true; }
+  void disable_timestamps() { timestamps_ = false; }
+
+  /* Send segments of at most `mss` bytes beyond the fixed headers, as the receiver's SYN allows (RFC 9293); */
+  /* the timestamp option comes out of that, so payloads are 12 bytes smaller with timestamps (RFC 6691) */
+  /* (TCPConfig::MAX_PAYLOAD_SIZE by default; TCPPeer sets the smaller of its own MSS and the peer's) */
+  void set_mss( uint64_t mss ) { mss_ = mss; }
+
+  /* Leave `length` bytes of the MSS for the options the receiver puts on our segments (its SACK */
+  /* blocks), so new segments fit with them, as Linux's tcp_current_mss() does (TCPPeer updates it) */
+  void set_receiver_options_length( uint64_t length ) { receiver_options_length_ = length; }
+
+  /* Limit what is in flight to min(cwnd, the receiver's window), and pace it, as `cc` decides */
+  /* (nullptr, the default, for no congestion control) */
+  void set_congestion_control( std::unique_ptr<CongestionControl> cc ) { cc_ = std::move( cc ); }
+  const CongestionControl* congestion_control() const { return cc_.get(); }
+
+  struct RTTEstimate
+  {
+    uint64_t srtt_ms {};   // smoothed round-trip time (0 until the first sample)
+    uint64_t rttvar_ms {}; // round-trip time variation
+    uint64_t rto_ms {};    // current retransmission timeout, including any backoff
+    uint64_t samples {};   // how many RTT samples have been taken
+  };
+
   // Accessors
   uint64_t sequence_numbers_in_flight() const;  // How many sequence numbers are outstanding?
   uint64_t consecutive_retransmissions() const; // How many consecutive *re*transmissions have happened?
+  RTTEstimate rtt_estimate() const;             // Round-trip time estimate and current RTO
+  uint64_t fast_retransmissions() const;        // How many retransmissions did ACKs (not timeouts) trigger?
+  uint64_t max_payload_size() const;            // How many payload bytes fit in one segment?
+  uint64_t mss() const;                         // How many bytes of payload and options fit in one segment?
   Writer& writer() { return input_.writer(); }
   const Writer& writer() const { return input_.writer(); }
 
@@ -49,17 +118,66 @@ private:
   // Variables initialized in constructor
   ByteStream input_;
   Wrap32 isn_;
-  uint16_t rwnd { 1 };
+  uint64_t rwnd { 1 };
+  uint8_t window_shift_ { 0 }; // 对方通告的窗口要左移的位数（RFC 7323）
+  uint64_t max_send_capacity_ { 0 }; // input_的容量最多跟着窗口长到这么大，0就是不长
   uint64_t dup_count { 0 }; // 计数冗余，老实说我觉得64位有点多余
   uint64_t initial_RTO_ms_;
   uint64_t RTO_ms_;
   uint64_t accumulated_time { 0 }; // 累计时间，用于计算超时
+  uint64_t now_ms_ { 0 };          // 所有 tick 加起来的时间，作为发送时间戳
+  uint64_t retained_ { 0 };        // 已经发送、还没被确认的payload字节数，它们留在input_的最前面，确认后才pop
+  // RFC 6298 的RTT估计，和Linux一样用定点数：srtt8_是SRTT的8倍，rttvar4_是RTTVAR的4倍
+  bool adaptive_RTO_ { false };
+  uint64_t min_RTO_ms_ { 0 };
+  uint64_t max_RTO_ms_ { UINT64_MAX };
+  uint64_t srtt8_ { 0 };
+  uint64_t rttvar4_ { 0 };
+  uint64_t rtt_samples_ { 0 };
+  // 快速重传和NewReno（RFC 5681、RFC 6582）
+  bool fast_retransmit_ { false };
+  uint64_t dup_acks_ { 0 };             // 连续收到的重复ack个数
+  bool in_recovery_ { false };          // 是否在快速恢复中
+  uint64_t recover_ { 0 };              // 进入恢复（或超时）时的NextByte2Sent，ack到这里才算恢复完成
+  bool retransmit_lost_ { false };      // 收到第三个重复ack、部分确认或者新的SACK块，下次push时重传丢了的段
+  uint64_t fast_retransmissions_ { 0 };
+  // SACK（RFC 2018）：被SACK块覆盖的段在transButUnack里做标记，恢复时只重传标记之间的洞
+  bool sack_ { false };
+  bool peer_sacks_ { false };      // 对方确实发来过SACK块：那就只按记分板判断丢包，不再用NewReno的部分确认规则
+  uint64_t lost_end_ { 0 };        // 这之前没被SACK的段都算丢了：最高的SACK块的右端，超时以后是NextByte2Sent
+  uint64_t recovery_episode_ { 0 }; // 每次进入恢复或者超时加一，段上记着自己在哪一次里重传过
+  bool first_hole_ { false };       // 刚进入恢复：第一个洞不管窗口都马上重传
+  bool timestamps_ { false }; // 每个段带上now_ms_作为TSval，用回显的TSecr测RTT（RFC 7323）
+  uint64_t mss_ { TCPConfig::MAX_PAYLOAD_SIZE }; // 对方SYN里的MSS（和自己的取小），payload和选项加起来不超过它
+  uint64_t receiver_options_length_ { 0 };       // 接收方要放在段上的选项（SACK块）的长度，也从MSS里扣掉
+  // 拥塞控制：在途的序号不超过min(cwnd, rwnd)；有pacing rate的时候还要攒够额度才能发
+  std::unique_ptr<CongestionControl> cc_ {};
+  uint64_t delivered_at_ms_ { 0 }; // 最后一次有新数据被确认的时间
+  int64_t pacing_credit_ { 0 }; // 按pacing rate随时间累积的可发字节数，单位是千分之一字节（慢速率下一个tick也不会取整成0）
   uint64_t NextByte2Sent {0};    // absolute sequence number denote the next Bytes to be sent
   uint64_t LastByteAcked {0};    //  absolute sequence number denote the latest last bytes that have acked
-  // 开一个pair的vector，把在传输层切片但是没有得到ack的数据保存起来
-  std::vector<TCPSenderMessage> transButUnack {};
+  // 把在传输层切片但是没有得到ack的数据保存起来（环形队列，ack时二分查找）
+  RetransmissionQueue transButUnack;
   bool has_trans_win0_{false};
   bool SYN{true};
   bool FIN{true};
   void FindMaxSeg(TCPSenderMessage& sendMsg);
+  uint64_t unsent() const { return reader().bytes_buffered() - retained_; } // 还没发送过的字节数
+  void copy_payload( uint64_t offset, uint64_t len, std::string& payload ) const; // 从input_里取出一段payload
+  void release( TCPSenderMessage&& msg );                                        // payload用完还给buffer pool
+  void sample_rtt( uint64_t rtt_ms );                                            // 用一个RTT样本更新估计和RTO
+  void retransmit( size_t i, const TransmitFunction& transmit );                 // 重传transButUnack的第i个段
+  void retransmit_lost( const TransmitFunction& transmit );                      // 快速重传：最老的段，或者SACK之间的洞
+  bool update_scoreboard( const TCPReceiverMessage& msg, uint64_t ackno );       // 记下SACK块，返回有没有新覆盖的段
+  uint64_t pipe() const; // RFC 6675：还在网络里的序号数（没被SACK、也没丢，或者丢了但已经重传）
+  uint64_t window() const { return cc_ ? std::min<uint64_t>( rwnd, cc_->cwnd() ) : rwnd; } // 能在途的序号数
+  bool paced() const { return cc_ and cc_->pacing_rate() != 0; }
+  std::optional<uint32_t> timestamp() const // 要放在段上的TSval
+  {
+    return timestamps_ ? std::optional { static_cast<uint32_t>( now_ms_ ) } : std::nullopt;
+  }
+  bool can_send() const
+  {
+    return NextByte2Sent - LastByteAcked < window() and ( not paced() or pacing_credit_ > 0 );
+  }
 };
@@ -1,6 +1,8 @@
 #pragma once
 
+#include <algorithm>
 #include <cstdint>
+#include <span>
 
 /*
  * The Wrap32 type represents a 32-bit unsigned integer that:
@@ -11,10 +13,13 @@
 class Wrap32
 {
 public:
-  explicit Wrap32( uint32_t raw_value ) : raw_value_( raw_value ) {}
+  constexpr explicit Wrap32( uint32_t raw_value ) : raw_value_( raw_value ) {}
 
   /* Construct a Wrap32 given an absolute sequence number n and the zero point. */
-  static Wrap32 wrap( uint64_t n, Wrap32 zero_point );
+  static constexpr Wrap32 wrap( uint64_t n, Wrap32 zero_point )
+  {
+    return Wrap32 { static_cast<uint32_t>( n ) + zero_point.raw_value_ };
+  }
 
   /*
    * The unwrap method returns an absolute sequence number that wraps to this Wrap32, given the zero point
@@ -22,12 +27,41 @@ public:
    *
    * There are many possible absolute sequence numbers that all wrap to the same Wrap32.
    * The unwrap method should return the one that is closest to the checkpoint.
+   *
+   * The answer is the first absolute seqno at or after checkpoint - 2^31 that wraps to this value (that
+   * lower bound clamped so the whole 2^32 range after it stays within uint64_t). There are no branches,
+   * so a loop over many seqnos (see unwrap_many) can vectorize.
    */
-  uint64_t unwrap( Wrap32 zero_point, uint64_t checkpoint ) const;
+  constexpr uint64_t unwrap( Wrap32 zero_point, uint64_t checkpoint ) const
+  {
+    const uint64_t lower = std::min( std::max( checkpoint, half ) - half, UINT64_MAX - UINT32_MAX );
+    return lower + static_cast<uint32_t>( raw_value_ - zero_point.raw_value_ - static_cast<uint32_t>( lower ) );
+  }
+
+  /* Unwrap every seqno in `seqnos` against the same zero point and checkpoint, into `out` (same size). */
+  static void unwrap_many( std::span<const Wrap32> seqnos,
+                           Wrap32 zero_point,
+                           uint64_t checkpoint,
+                           std::span<uint64_t> out );
+
+  constexpr Wrap32 operator+( uint32_t n ) const { return Wrap32 { raw_value_ + n }; }
+  constexpr bool operator==( const Wrap32& other ) const { return raw_value_ == other.raw_value_; }
 
-  Wrap32 operator+( uint32_t n ) const { return Wrap32 { raw_value_ + n }; }
-  bool operator==( const Wrap32& other ) const { return raw_value_ == other.raw_value_; }
+  /*
+   * Sequence-space arithmetic (RFC 1982): `a.distance( b )` is the signed number of sequence numbers from a
+   * to b, and a < b when a comes before b, i.e. when that distance is positive. This is only meaningful for
+   * seqnos less than 2^31 apart, which holds for any two bytes that can be in flight at once.
+   */
+  constexpr int32_t distance( const Wrap32& to ) const
+  {
+    return static_cast<int32_t>( to.raw_value_ - raw_value_ );
+  }
+  constexpr bool operator<( const Wrap32& other ) const { return distance( other ) > 0; }
+  constexpr bool operator<=( const Wrap32& other ) const { return distance( other ) >= 0; }
+  constexpr bool operator>( const Wrap32& other ) const { return distance( other ) < 0; }
+  constexpr bool operator>=( const Wrap32& other ) const { return distance( other ) <= 0; }
 
 protected:
+  static constexpr uint64_t half = 1UL << 31;
   uint32_t raw_value_ {};
 };
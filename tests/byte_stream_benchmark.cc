@@ -0,0 +1,307 @@
+#include "byte_stream.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+/*
+ * byte_stream_benchmark: sweeps ByteStream configurations and reports, for each one,
+ * throughput, heap allocations per MB transferred, and p50/p99 latency of push() and of a
+ * read (peek + copy + pop). Unlike byte_stream_speed_test it has no pass/fail threshold;
+ * it is meant to be run by hand or by the `benchmark` target and compared across builds.
+ *
+ * Usage: byte_stream_benchmark [--format=table|json|csv] [--output=FILE] [--bytes=N] [--quick]
+ */
+
+namespace {
+// Every operator new in the process goes through here, so the timed loops can count allocations.
+size_t allocation_count = 0; // NOLINT(*-avoid-non-const-global-variables)
+} // namespace
+
+void* operator new( size_t size )
+{
+  ++allocation_count;
+  if ( void* ptr = malloc( size ) ) { // NOLINT(*-no-malloc, *-owning-memory)
+    return ptr;
+  }
+  throw bad_alloc {};
+}
+
+void operator delete( void* ptr ) noexcept
+{
+  free( ptr ); // NOLINT(*-no-malloc, *-owning-memory)
+}
+
+void operator delete( void* ptr, size_t /* size */ ) noexcept
+{
+  free( ptr ); // NOLINT(*-no-malloc, *-owning-memory)
+}
+
+namespace {
+struct Config
+{
+  ByteStream::Backend backend;
+  size_t capacity;
+  size_t write_size;
+  size_t read_size;
+  size_t chunks; // writes attempted between two rounds of reads
+};
+
+struct Result
+{
+  Config config;
+  double gigabits_per_second;
+  double allocations_per_mb;
+  double push_p50_ns, push_p99_ns;
+  double read_p50_ns, read_p99_ns;
+};
+
+string_view backend_name( ByteStream::Backend backend )
+{
+  return backend == ByteStream::Backend::Ring ? "ring" : "chunked";
+}
+
+string make_data( size_t len )
+{
+  default_random_engine rd { 789 };
+  uniform_int_distribution<char> ud;
+  string ret;
+  ret.reserve( len );
+  for ( size_t i = 0; i < len; ++i ) {
+    ret += ud( rd );
+  }
+  return ret;
+}
+
+vector<string> split( const string& data, size_t write_size )
+{
+  vector<string> pieces;
+  pieces.reserve( data.size() / write_size + 1 );
+  for ( size_t i = 0; i < data.size(); i += write_size ) {
+    pieces.emplace_back( data.substr( i, write_size ) );
+  }
+  return pieces;
+}
+
+double percentile( vector<double>& samples, double p )
+{
+  if ( samples.empty() ) {
+    return 0;
+  }
+  const auto nth = samples.begin() + static_cast<ptrdiff_t>( p * static_cast<double>( samples.size() - 1 ) );
+  nth_element( samples.begin(), nth, samples.end() );
+  return *nth;
+}
+
+// Move every piece through a ByteStream. With `push_ns`/`read_ns` set, each push and each read
+// is timed separately (which slows the run down, so throughput is measured in a run without them).
+void transfer( const Config& config,
+               vector<string> pieces,
+               string& output,
+               vector<double>* push_ns = nullptr,
+               vector<double>* read_ns = nullptr )
+{
+  ByteStream bs { config.capacity, config.backend };
+  output.clear();
+  auto next = pieces.begin();
+
+  while ( not bs.reader().is_finished() ) {
+    for ( size_t i = 0; i < config.chunks and next != pieces.end(); ++i ) {
+      if ( next->size() > bs.writer().available_capacity() ) {
+        break;
+      }
+      if ( push_ns ) {
+        const auto start = steady_clock::now();
+        bs.writer().push( move( *next ) );
+        push_ns->push_back( duration<double, nano>( steady_clock::now() - start ).count() );
+      } else {
+        bs.writer().push( move( *next ) );
+      }
+      ++next;
+    }
+    if ( next == pieces.end() and not bs.writer().is_closed() ) {
+      bs.writer().close();
+    }
+
+    while ( bs.reader().bytes_buffered() ) {
+      const auto start = steady_clock::now();
+      const auto view = bs.reader().peek().substr( 0, config.read_size );
+      output.append( view );
+      bs.reader().pop( view.size() );
+      if ( read_ns ) {
+        read_ns->push_back( duration<double, nano>( steady_clock::now() - start ).count() );
+      }
+    }
+  }
+}
+
+Result run( const Config& config, const string& data )
+{
+  Result result { config, 0, 0, 0, 0, 0, 0 };
+  const vector<string> pieces = split( data, config.write_size );
+  string output;
+  output.reserve( data.size() );
+
+  // throughput and allocations (the copy of `pieces` is made before the clock starts)
+  {
+    vector<string> copy = pieces;
+    const size_t allocations_before = allocation_count;
+    const auto start = steady_clock::now();
+    transfer( config, move( copy ), output );
+    const auto elapsed = duration<double>( steady_clock::now() - start ).count();
+    const size_t allocations = allocation_count - allocations_before;
+
+    if ( output != data ) {
+      throw runtime_error( "Mismatch between data written and read" );
+    }
+    result.gigabits_per_second = 8 * static_cast<double>( data.size() ) / elapsed / 1e9;
+    result.allocations_per_mb = static_cast<double>( allocations ) / ( static_cast<double>( data.size() ) / 1e6 );
+  }
+
+  // per-operation latency
+  {
+    vector<double> push_ns;
+    vector<double> read_ns;
+    push_ns.reserve( pieces.size() );
+    read_ns.reserve( data.size() / min( config.read_size, config.write_size ) + pieces.size() + 1 );
+    transfer( config, pieces, output, &push_ns, &read_ns );
+    result.push_p50_ns = percentile( push_ns, 0.5 );
+    result.push_p99_ns = percentile( push_ns, 0.99 );
+    result.read_p50_ns = percentile( read_ns, 0.5 );
+    result.read_p99_ns = percentile( read_ns, 0.99 );
+  }
+
+  return result;
+}
+
+void print_table( ostream& out, const vector<Result>& results )
+{
+  out << left << setw( 8 ) << "backend" << right << setw( 9 ) << "capacity" << setw( 7 ) << "write" << setw( 7 )
+      << "read" << setw( 7 ) << "chunks" << setw( 9 ) << "Gbit/s" << setw( 10 ) << "allocs/MB" << setw( 10 )
+      << "push p50" << setw( 10 ) << "push p99" << setw( 10 ) << "read p50" << setw( 10 ) << "read p99\n";
+  for ( const auto& r : results ) {
+    out << left << setw( 8 ) << backend_name( r.config.backend ) << right << setw( 9 ) << r.config.capacity
+        << setw( 7 ) << r.config.write_size << setw( 7 ) << r.config.read_size << setw( 7 ) << r.config.chunks
+        << fixed << setprecision( 2 ) << setw( 9 ) << r.gigabits_per_second << setprecision( 1 ) << setw( 10 )
+        << r.allocations_per_mb << setprecision( 0 ) << setw( 10 ) << r.push_p50_ns << setw( 10 ) << r.push_p99_ns
+        << setw( 10 ) << r.read_p50_ns << setw( 9 ) << r.read_p99_ns << "\n";
+  }
+}
+
+void print_csv( ostream& out, const vector<Result>& results )
+{
+  out << "backend,capacity,write_size,read_size,chunks,gbit_per_s,allocs_per_mb,"
+         "push_p50_ns,push_p99_ns,read_p50_ns,read_p99_ns\n";
+  for ( const auto& r : results ) {
+    out << backend_name( r.config.backend ) << "," << r.config.capacity << "," << r.config.write_size << ","
+        << r.config.read_size << "," << r.config.chunks << "," << r.gigabits_per_second << ","
+        << r.allocations_per_mb << "," << r.push_p50_ns << "," << r.push_p99_ns << "," << r.read_p50_ns << ","
+        << r.read_p99_ns << "\n";
+  }
+}
+
+void print_json( ostream& out, const vector<Result>& results )
+{
+  out << "[\n";
+  for ( size_t i = 0; i < results.size(); ++i ) {
+    const auto& r = results[i];
+    out << "  {\"backend\": \"" << backend_name( r.config.backend ) << "\", \"capacity\": " << r.config.capacity
+        << ", \"write_size\": " << r.config.write_size << ", \"read_size\": " << r.config.read_size
+        << ", \"chunks\": " << r.config.chunks << ", \"gbit_per_s\": " << r.gigabits_per_second
+        << ", \"allocs_per_mb\": " << r.allocations_per_mb << ", \"push_p50_ns\": " << r.push_p50_ns
+        << ", \"push_p99_ns\": " << r.push_p99_ns << ", \"read_p50_ns\": " << r.read_p50_ns
+        << ", \"read_p99_ns\": " << r.read_p99_ns << "}" << ( i + 1 < results.size() ? "," : "" ) << "\n";
+  }
+  out << "]\n";
+}
+
+void program_body( const vector<string>& args )
+{
+  string format = "table";
+  string output_path;
+  size_t bytes = 4'000'000;
+  bool quick = false;
+
+  for ( const auto& arg : args ) {
+    if ( arg.starts_with( "--format=" ) ) {
+      format = arg.substr( 9 );
+    } else if ( arg.starts_with( "--output=" ) ) {
+      output_path = arg.substr( 9 );
+    } else if ( arg.starts_with( "--bytes=" ) ) {
+      bytes = stoul( arg.substr( 8 ) );
+    } else if ( arg == "--quick" ) {
+      quick = true;
+    } else {
+      throw runtime_error( "usage: byte_stream_benchmark [--format=table|json|csv] [--output=FILE] "
+                           "[--bytes=N] [--quick]" );
+    }
+  }
+  if ( format != "table" and format != "json" and format != "csv" ) {
+    throw runtime_error( "unknown format: " + format );
+  }
+
+  const vector<size_t> capacities = quick ? vector<size_t> { 65536 } : vector<size_t> { 4096, 65536, 1 << 20 };
+  const vector<size_t> write_sizes = quick ? vector<size_t> { 40, 1500 } : vector<size_t> { 40, 1500, 16384 };
+  const vector<size_t> read_sizes = quick ? vector<size_t> { 1500 } : vector<size_t> { 128, 1500, 65536 };
+  const vector<size_t> chunk_counts = quick ? vector<size_t> { 1 } : vector<size_t> { 1, 16 };
+
+  const string data = make_data( bytes );
+  vector<Result> results;
+  for ( const auto backend : { ByteStream::Backend::Chunked, ByteStream::Backend::Ring } ) {
+    for ( const auto capacity : capacities ) {
+      for ( const auto write_size : write_sizes ) {
+        if ( write_size > capacity ) {
+          continue;
+        }
+        for ( const auto read_size : read_sizes ) {
+          for ( const auto chunks : chunk_counts ) {
+            results.push_back( run( { backend, capacity, write_size, read_size, chunks }, data ) );
+          }
+        }
+      }
+    }
+  }
+
+  ofstream file;
+  if ( not output_path.empty() ) {
+    file.open( output_path );
+    if ( not file ) {
+      throw runtime_error( "could not open " + output_path );
+    }
+  }
+  ostream& out = output_path.empty() ? cout : file;
+
+  if ( format == "json" ) {
+    print_json( out, results );
+  } else if ( format == "csv" ) {
+    print_csv( out, results );
+  } else {
+    print_table( out, results );
+  }
+}
+} // namespace
+
+int main( int argc, char* argv[] )
+{
+  try {
+    program_body( { argv + 1, argv + argc } );
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
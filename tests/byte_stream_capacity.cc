@@ -97,6 +97,20 @@ int main()
       test.execute( BytesBuffered { 1 } );
     }
 
+    {
+      ByteStreamTestHarness test { "grow capacity", 2 };
+      test.execute( Push { "cat" } );
+      test.execute( AvailableCapacity { 0 } );
+      test.execute( GrowCapacity { 5 } );
+      test.execute( AvailableCapacity { 3 } );
+      test.execute( Push { "tle" } );
+      test.execute( BytesBuffered { 5 } );
+      test.execute( GrowCapacity { 1 } );
+      test.execute( AvailableCapacity { 0 } );
+      test.execute( ReadAll { "catle" } );
+      test.execute( AvailableCapacity { 5 } );
+    }
+
   } catch ( const exception& e ) {
     cerr << "Exception: " << e.what() << endl;
     return EXIT_FAILURE;
@@ -0,0 +1,85 @@
+#include "byte_stream.hh"
+#include "byte_stream_test_harness.hh"
+
+#include <exception>
+#include <iostream>
+
+using namespace std;
+
+int main()
+{
+  try {
+    {
+      ByteStreamTestHarness test { "small pushes share a chunk", 15 };
+
+      test.execute( SetCoalesceSize { ByteStream::small_write_coalesce_size } );
+      test.execute( Push { "cat" } );
+      test.execute( Push { "tac" } );
+      test.execute( Push { "dog" } );
+      test.execute( PeekViews { 8, { "cattacdog" } } );
+      test.execute( Pop { 4 } );
+      test.execute( Push { "s" } );
+      test.execute( PeekViews { 8, { "acdogs" } } );
+      test.execute( BytesBuffered { 6 } );
+      test.execute( AvailableCapacity { 9 } );
+      test.execute( Pop { 6 } );
+      test.execute( Push { "pig" } );
+      test.execute( Peek { "pig" } );
+      test.execute( BytesPushed { 13 } );
+      test.execute( BytesPopped { 10 } );
+    }
+
+    {
+      ByteStreamTestHarness test { "coalescing respects capacity", 5 };
+
+      test.execute( SetCoalesceSize { ByteStream::small_write_coalesce_size } );
+      test.execute( Push { "cat" } );
+      test.execute( Push { "tac" } );
+      test.execute( PeekViews { 8, { "catta" } } );
+      test.execute( AvailableCapacity { 0 } );
+    }
+
+    {
+      ByteStreamTestHarness test { "large pushes keep their own chunks", 5000 };
+
+      test.execute( SetCoalesceSize { 8 } );
+      test.execute( Push { "abc" } );
+      test.execute( Push { "0123456789" } );
+      test.execute( PeekViews { 8, { "abc", "0123456789" } } );
+    }
+
+    {
+      ByteStreamTestHarness test { "coalescing is off by default", 15 };
+
+      test.execute( Push { "cat" } );
+      test.execute( Push { "tac" } );
+      test.execute( PeekViews { 8, { "cat", "tac" } } );
+    }
+
+    {
+      ByteStreamTestHarness test { "coalescing can be turned off", 15 };
+
+      test.execute( SetCoalesceSize { ByteStream::small_write_coalesce_size } );
+      test.execute( SetCoalesceSize { 0 } );
+      test.execute( Push { "cat" } );
+      test.execute( Push { "tac" } );
+      test.execute( PeekViews { 8, { "cat", "tac" } } );
+    }
+
+    {
+      ByteStreamTestHarness test { "reservations and small pushes", 100 };
+
+      test.execute( SetCoalesceSize { ByteStream::small_write_coalesce_size } );
+      test.execute( Push { "ab" } );
+      test.execute( ReserveCommit { 10, "0123456789" } );
+      test.execute( Push { "cd" } );
+      test.execute( ReadAll { "ab0123456789cd" } );
+      test.execute( IsFinished { false } );
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,230 @@
+#include "byte_stream.hh"
+#include "eventloop.hh"
+#include "exception.hh"
+#include "file_descriptor.hh"
+#include "task.hh"
+
+#include <array>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <sys/socket.h>
+
+using namespace std;
+
+namespace {
+void expect( bool condition, const string& what )
+{
+  if ( not condition ) {
+    throw runtime_error( "ByteStream awaitables: " + what );
+  }
+}
+
+// Resume everything that has been scheduled.
+void run( EventLoop& loop )
+{
+  while ( loop.wait_next_event( 0 ) == EventLoop::Result::Success ) {}
+}
+
+Task read_n( Reader& reader, uint64_t n, string& out )
+{
+  co_await reader.readable( n );
+  read( reader, n, out );
+}
+
+Task write_all( Writer& writer, string data, uint64_t chunk )
+{
+  while ( not data.empty() ) {
+    co_await writer.writable( 1 );
+    if ( writer.has_error() ) {
+      co_return;
+    }
+    const auto len = min( { chunk, writer.available_capacity(), static_cast<uint64_t>( data.size() ) } );
+    writer.push( data.substr( 0, len ) );
+    data.erase( 0, len );
+  }
+  writer.close();
+}
+
+Task read_all( Reader& reader, string& out )
+{
+  while ( true ) {
+    co_await reader.readable( 1 );
+    if ( reader.is_finished() or reader.has_error() ) {
+      break;
+    }
+    out += reader.peek();
+    reader.pop( reader.peek().size() );
+  }
+}
+
+// Pass one byte back and forth forever.
+Task bounce( Reader& reader, Writer& writer )
+{
+  while ( true ) {
+    co_await reader.readable( 1 );
+    reader.pop( 1 );
+    writer.push( "x" );
+  }
+}
+
+Task wait_finished( Reader& reader, bool& finished )
+{
+  co_await reader.finished();
+  finished = true;
+}
+
+void readable()
+{
+  EventLoop loop;
+  ByteStream bs { 100 };
+  string out;
+
+  Task task = read_n( bs.reader(), 5, out );
+  expect( not task.done(), "suspends while nothing is buffered" );
+
+  bs.writer().push( "hel" );
+  run( loop );
+  expect( not task.done() and out.empty(), "does not resume before `n` bytes are buffered" );
+
+  bs.writer().push( "lo" );
+  expect( not task.done(), "resumes from the EventLoop, not from push()" );
+  run( loop );
+  expect( task.done() and out == "hello", "resumes once `n` bytes are buffered" );
+
+  // no suspension at all when the condition already holds
+  bs.writer().push( "world" );
+  Task ready = read_n( bs.reader(), 5, out );
+  expect( ready.done() and out == "world", "does not suspend when already readable" );
+}
+
+void pipeline()
+{
+  EventLoop loop;
+  ByteStream bs { 7 };
+  string data;
+  for ( int i = 0; i < 1000; i++ ) {
+    data += static_cast<char>( 'a' + i % 26 );
+  }
+  string out;
+
+  Task consumer = read_all( bs.reader(), out );
+  Task producer = write_all( bs.writer(), data, 5 );
+  bool finished = false;
+  Task watcher = wait_finished( bs.reader(), finished );
+
+  run( loop );
+  expect( producer.done() and consumer.done(), "both ends run to completion" );
+  expect( out == data, "bytes through the pipeline" );
+  expect( finished and watcher.done(), "finished() resumes when the stream is closed and drained" );
+}
+
+void lifetimes()
+{
+  EventLoop loop;
+  string out;
+
+  {
+    // a coroutine destroyed while parked on the stream is forgotten by it
+    ByteStream bs { 10 };
+    {
+      const Task task = read_n( bs.reader(), 1, out );
+    }
+    bs.writer().push( "x" );
+    run( loop );
+  }
+
+  {
+    // ... and one destroyed after being scheduled is forgotten by the EventLoop
+    ByteStream bs { 10 };
+    {
+      const Task task = read_n( bs.reader(), 1, out );
+      bs.writer().push( "x" );
+    }
+    run( loop );
+  }
+  expect( out.empty(), "destroyed coroutines never resume" );
+
+  {
+    // a moved stream takes its waiters along (they still refer to the moved-from object); a copy does not
+    ByteStream bs { 10 };
+    const Task task = read_n( bs.reader(), 2, out );
+    ByteStream moved { move( bs ) };
+    ByteStream copy { moved };
+    copy.writer().push( "no" );
+    run( loop );
+    expect( not task.done(), "a copy of a stream does not wake the original's waiters" );
+    moved.writer().push( "ok" );
+    run( loop );
+    expect( task.done(), "a moved-to stream wakes the waiters" );
+  }
+
+  {
+    // the stream may also go away first
+    auto bs = make_unique<ByteStream>( 10 );
+    const Task task = read_n( bs->reader(), 1, out );
+    bs.reset();
+    run( loop );
+    expect( not task.done(), "waiters of a destroyed stream stay suspended" );
+  }
+}
+
+void fairness()
+{
+  // two coroutines that keep waking each other must not keep the loop from polling its fds
+  EventLoop loop;
+  array<int, 2> fds {};
+  CheckSystemCall( "socketpair", ::socketpair( AF_UNIX, SOCK_STREAM, 0, fds.data() ) );
+  FileDescriptor read_end { fds[0] };
+  FileDescriptor write_end { fds[1] };
+  write_end.write( "ready" );
+
+  bool polled = false;
+  string buffer;
+  loop.add_rule( "read from socket", read_end, Direction::In, [&] {
+    read_end.read( buffer );
+    polled = true;
+  } );
+
+  ByteStream ping { 10 };
+  ByteStream pong { 10 };
+  const Task a = bounce( ping.reader(), pong.writer() );
+  const Task b = bounce( pong.reader(), ping.writer() );
+  ping.writer().push( "x" );
+  for ( int i = 0; i < 10 and not polled; i++ ) {
+    loop.wait_next_event( 1000 );
+  }
+  expect( polled, "fd rules still run while coroutines keep scheduling each other" );
+}
+
+void errors()
+{
+  EventLoop loop;
+  ByteStream bs { 4 };
+  bs.writer().push( "full" );
+
+  bool finished = false;
+  const Task writer_task = write_all( bs.writer(), "more", 4 );
+  const Task reader_task = wait_finished( bs.reader(), finished );
+  bs.set_error();
+  run( loop );
+  expect( finished and writer_task.done(), "set_error() resumes every waiter" );
+}
+} // namespace
+
+int main()
+{
+  try {
+    readable();
+    pipeline();
+    lifetimes();
+    fairness();
+    errors();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
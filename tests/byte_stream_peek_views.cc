@@ -0,0 +1,85 @@
+#include "byte_stream.hh"
+#include "byte_stream_test_harness.hh"
+
+#include <exception>
+#include <iostream>
+
+using namespace std;
+
+int main()
+{
+  try {
+    {
+      ByteStreamTestHarness test { "peek_views on empty stream", 15 };
+
+      test.execute( PeekViews { 4, {} } );
+      test.execute( Push { "cat" } );
+      test.execute( PeekViews { 0, {} } );
+    }
+
+    {
+      ByteStreamTestHarness test { "peek_views covers every pushed chunk", 15 };
+
+      test.execute( SetCoalesceSize { 0 } ); // keep each push in a chunk of its own
+      test.execute( Push { "cat" } );
+      test.execute( Push { "tac" } );
+      test.execute( Push { "dog" } );
+      test.execute( PeekViews { 8, { "cat", "tac", "dog" } } );
+      test.execute( PeekViews { 2, { "cat", "tac" } } );
+      test.execute( Pop { 1 } );
+      test.execute( PeekViews { 8, { "at", "tac", "dog" } } );
+      test.execute( Pop { 3 } );
+      test.execute( PeekViews { 8, { "ac", "dog" } } );
+      test.execute( Pop { 2 } );
+      test.execute( PeekViews { 8, { "dog" } } );
+      test.execute( Pop { 3 } );
+      test.execute( PeekViews { 8, {} } );
+    }
+
+    {
+      ByteStreamTestHarness test { "peek_at finds the chunk holding an offset", 20 };
+
+      test.execute( SetCoalesceSize { 0 } ); // keep each push in a chunk of its own
+      test.execute( Push { "cat" } );
+      test.execute( Push { "tac" } );
+      test.execute( Push { "dog" } );
+      test.execute( PeekAt { 0, "cat" } );
+      test.execute( PeekAt { 2, "t" } );
+      test.execute( PeekAt { 3, "tac" } );
+      test.execute( PeekAt { 7, "og" } );
+      test.execute( PeekAt { 9, "" } );
+      test.execute( Pop { 4 } );
+      test.execute( PeekAt { 0, "ac" } );
+      test.execute( PeekAt { 2, "dog" } );
+      test.execute( SetCoalesceSize { 16 } ); // appended to the last chunk
+      test.execute( Push { "god" } );
+      test.execute( PeekAt { 3, "oggod" } );
+      test.execute( Pop { 2 } );
+      test.execute( PeekAt { 0, "doggod" } );
+    }
+
+    {
+      ByteStreamTestHarness test { "peek_views respects capacity", 5 };
+
+      test.execute( SetCoalesceSize { 0 } ); // keep each push in a chunk of its own
+      test.execute( Push { "cat" } );
+      test.execute( Push { "tac" } );
+      test.execute( PeekViews { 8, { "cat", "ta" } } );
+    }
+
+    {
+      ByteStreamTestHarness test { "peek_views on ring backend", 15, ByteStream::Backend::Ring };
+
+      test.execute( Push { "cat" } );
+      test.execute( Push { "tac" } );
+      test.execute( PeekViews { 8, { "cattac" } } );
+      test.execute( Pop { 6 } );
+      test.execute( PeekViews { 8, {} } );
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
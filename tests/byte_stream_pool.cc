@@ -0,0 +1,111 @@
+#include "buffer_pool.hh"
+#include "byte_stream.hh"
+#include "reassembler.hh"
+
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+namespace {
+void expect( bool condition, const string& what )
+{
+  if ( not condition ) {
+    throw runtime_error( "BufferPool: " + what );
+  }
+}
+
+void pool_basics()
+{
+  BufferPool pool { 2, 1 };
+
+  string a = pool.acquire( 100 );
+  expect( a.empty() and a.capacity() >= BufferPool::small_chunk, "small acquire gives a small-class buffer" );
+  expect( pool.misses() == 1 and pool.hits() == 0, "first acquire is a miss" );
+
+  a = "hello";
+  pool.release( move( a ) );
+  expect( pool.free_buffers() == 1, "released buffer is kept" );
+
+  const string b = pool.acquire( 10 );
+  expect( b.empty(), "reused buffer is cleared" );
+  expect( pool.hits() == 1 and pool.free_buffers() == 0, "second acquire is a hit" );
+
+  string c = pool.acquire( 5000 );
+  expect( c.capacity() >= BufferPool::large_chunk, "medium acquire gives a large-class buffer" );
+  pool.release( move( c ) );
+  pool.release( pool.acquire( 5000 ) );
+  expect( pool.hits() == 2 and pool.free_buffers() == 1, "large buffer is reused" );
+
+  const string d = pool.acquire( 3 * BufferPool::large_chunk );
+  expect( d.capacity() >= 3 * BufferPool::large_chunk, "oversized acquire still fits the request" );
+  pool.release( string( 300, 'x' ) );
+  expect( pool.free_buffers() == 1, "buffers outside every size class are not kept" );
+}
+
+void byte_stream_recycles()
+{
+  auto pool = make_shared<BufferPool>();
+  ByteStream bs { 100000 };
+  bs.set_buffer_pool( pool );
+
+  for ( int round = 0; round < 50; round++ ) {
+    string data = pool->acquire( 1500 );
+    data.assign( 1500, static_cast<char>( 'a' + round % 26 ) );
+    bs.writer().push( move( data ) );
+
+    auto space = bs.writer().reserve( 40000 );
+    space[0] = 'z';
+    bs.writer().commit( 40000 );
+
+    bs.reader().pop( bs.reader().bytes_buffered() );
+  }
+
+  // One buffer of each class is allocated up front; everything after that is recycled.
+  expect( pool->misses() == 2, "steady-state pushes and reservations reuse pooled buffers" );
+  expect( pool->hits() == 98, "hit count" );
+}
+
+void reassembler_recycles()
+{
+  auto pool = make_shared<BufferPool>();
+  ByteStream bs { 10000 };
+  bs.set_buffer_pool( pool );
+  Reassembler reassembler { move( bs ) };
+
+  const string data( 3000, 'r' );
+  uint64_t index = 0;
+  for ( int round = 0; round < 20; round++ ) {
+    // a later piece, then an earlier one that covers it (so the later one is dropped)
+    string later = pool->acquire( 500 );
+    later.assign( data, 0, 500 );
+    string earlier = pool->acquire( 2000 );
+    earlier.assign( data, 0, 2000 );
+    reassembler.insert( index + 1000, move( later ), false );
+    reassembler.insert( index, move( earlier ), false );
+    index += 2000;
+    reassembler.reader().pop( reassembler.reader().bytes_buffered() );
+  }
+
+  expect( reassembler.reader().bytes_popped() == index, "reassembled every byte" );
+  expect( pool->misses() == 2, "dropped and popped buffers come back to the pool" );
+  expect( pool->hits() == 38, "hit count" );
+}
+} // namespace
+
+int main()
+{
+  try {
+    pool_basics();
+    byte_stream_recycles();
+    reassembler_recycles();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,96 @@
+#include "byte_stream.hh"
+#include "byte_stream_test_harness.hh"
+#include "file_descriptor.hh"
+
+#include <algorithm>
+#include <array>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <unistd.h>
+
+using namespace std;
+
+int main()
+{
+  try {
+    for ( const auto backend : { ByteStream::Backend::Chunked, ByteStream::Backend::Ring } ) {
+      {
+        ByteStreamTestHarness test { "reserve/commit basics", 15, backend };
+
+        test.execute( Reservable { 4, 4 } );
+        test.execute( Reservable { 100, 15 } );
+        test.execute( ReserveCommit { 8, "cat" } );
+        test.execute( BytesPushed { 3 } );
+        test.execute( BytesBuffered { 3 } );
+        test.execute( AvailableCapacity { 12 } );
+        test.execute( Push { "tac" } );
+        test.execute( ReserveCommit { 100, "dog" } );
+        test.execute( Peek { "cattacdog" } );
+        test.execute( Reservable { 100, 6 } );
+        test.execute( Pop { 9 } );
+        test.execute( Reservable { 100, 15 } );
+        test.execute( ReserveCommit { 15, "0123456789abcde" } );
+        test.execute( Reservable { 1, 0 } );
+        test.execute( Close {} );
+        test.execute( ReadAll { "0123456789abcde" } );
+        test.execute( IsFinished { true } );
+      }
+
+      {
+        ByteStreamTestHarness test { "uncommitted reservation is invisible", 15, backend };
+
+        test.execute( Push { "cat" } );
+        test.execute( Reservable { 10, 10 } );
+        test.execute( ReserveCommit { 10, "" } );
+        test.execute( BytesPushed { 3 } );
+        test.execute( Peek { "cat" } );
+      }
+
+      {
+        // push() drops an uncommitted reservation, so commit() can't publish bytes over the pushed ones
+        ByteStream bs { 15, backend };
+        const auto space = bs.writer().reserve( 3 );
+        copy_n( "dog", 3, space.begin() );
+        bs.writer().push( "cat" );
+        bool committed = true;
+        try {
+          bs.writer().commit( 3 );
+        } catch ( const runtime_error& ) {
+          committed = false;
+        }
+        if ( committed or bs.reader().bytes_buffered() != 3 or bs.reader().peek() != "cat" ) {
+          throw runtime_error( "commit() after push() should fail and leave the pushed bytes alone" );
+        }
+      }
+    }
+
+    {
+      // FileDescriptor::read should fill caller-provided spans in order (via readv).
+      array<int, 2> fds {};
+      CheckSystemCall( "pipe", ::pipe( fds.data() ) );
+      FileDescriptor read_end { fds[0] };
+      FileDescriptor write_end { fds[1] };
+
+      write_end.write( "hello, world" );
+      array<char, 5> first {};
+      array<char, 20> second {};
+      const array<span<char>, 2> spans { span<char> { first }, span<char> { second } };
+      const size_t n = read_end.read( span<const span<char>> { spans } );
+      if ( n != 12 or string_view { first.data(), first.size() } != "hello"
+           or string_view { second.data(), 7 } != ", world" ) {
+        throw runtime_error( "FileDescriptor::read(spans) did not fill the buffers in order" );
+      }
+
+      write_end.close();
+      if ( read_end.read( span<char> { second } ) != 0 or not read_end.eof() ) {
+        throw runtime_error( "FileDescriptor::read(span) did not report EOF" );
+      }
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,79 @@
+#include "byte_stream.hh"
+#include "byte_stream_test_harness.hh"
+
+#include <exception>
+#include <iostream>
+
+using namespace std;
+
+int main()
+{
+  try {
+    constexpr auto ring = ByteStream::Backend::Ring;
+
+    {
+      ByteStreamTestHarness test { "ring: basic push/pop", 15, ring };
+
+      test.execute( Push { "cat" } );
+      test.execute( Push { "tac" } );
+      test.execute( PeekOnce { "cattac" } );
+      test.execute( BytesBuffered { 6 } );
+      test.execute( AvailableCapacity { 9 } );
+      test.execute( Pop { 2 } );
+      test.execute( PeekOnce { "ttac" } );
+      test.execute( BytesPopped { 2 } );
+      test.execute( Close {} );
+      test.execute( ReadAll { "ttac" } );
+      test.execute( IsFinished { true } );
+    }
+
+    {
+      ByteStreamTestHarness test { "ring: capacity is respected", 2, ring };
+
+      test.execute( Push { "cat" } );
+      test.execute( BytesPushed { 2 } );
+      test.execute( AvailableCapacity { 0 } );
+      test.execute( PeekOnce { "ca" } );
+      test.execute( Pop { 1 } );
+      test.execute( Push { "tac" } );
+      test.execute( PeekOnce { "at" } );
+      test.execute( BytesPushed { 3 } );
+    }
+
+    {
+      // Push enough to make the buffered bytes straddle the end of the underlying buffer.
+      const string first( 3000, 'x' );
+      string second;
+      for ( size_t i = 0; i < 3000; i++ ) {
+        second.push_back( static_cast<char>( 'a' + i % 26 ) );
+      }
+
+      ByteStreamTestHarness test { "ring: peek is contiguous across the wrap", 4096, ring };
+
+      test.execute( Push { first } );
+      test.execute( Pop { 2000 } );
+      test.execute( Push { second } );
+      test.execute( AvailableCapacity { 96 } );
+      test.execute( PeekOnce { first.substr( 2000 ) + second } );
+      test.execute( Pop { 2500 } );
+      test.execute( Push { second.substr( 0, 1000 ) } );
+      test.execute( PeekOnce { second.substr( 1500 ) + second.substr( 0, 1000 ) } );
+      test.execute( BytesBuffered { 2500 } );
+      test.execute( AvailableCapacity { 1596 } );
+    }
+
+    {
+      ByteStreamTestHarness test { "ring: zero capacity", 0, ring };
+
+      test.execute( Push { "cat" } );
+      test.execute( BytesPushed { 0 } );
+      test.execute( Pop { 1 } );
+      test.execute( BufferEmpty { true } );
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
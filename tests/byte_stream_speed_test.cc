@@ -11,7 +11,13 @@
 using namespace std;
 using namespace std::chrono;
 
-void speed_test( const size_t input_len,   // NOLINT(bugprone-easily-swappable-parameters)
+string_view backend_name( ByteStream::Backend backend )
+{
+  return backend == ByteStream::Backend::Ring ? "ring" : "chunked";
+}
+
+void speed_test( const ByteStream::Backend backend,
+                 const size_t input_len,   // NOLINT(bugprone-easily-swappable-parameters)
                  const size_t capacity,    // NOLINT(bugprone-easily-swappable-parameters)
                  const size_t random_seed, // NOLINT(bugprone-easily-swappable-parameters)
                  const size_t write_size,  // NOLINT(bugprone-easily-swappable-parameters)
@@ -34,7 +40,7 @@ void speed_test( const size_t input_len,   // NOLINT(bugprone-easily-swappable-p
     split_data.emplace( data.substr( i, write_size ) );
   }
 
-  ByteStream bs { capacity };
+  ByteStream bs { capacity, backend };
   string output_data;
   output_data.reserve( data.size() );
 
@@ -75,11 +81,84 @@ void speed_test( const size_t input_len,   // NOLINT(bugprone-easily-swappable-p
   fstream debug_output;
   debug_output.open( "/dev/tty" );
 
-  cout << "ByteStream with capacity=" << capacity << ", write_size=" << write_size << ", read_size=" << read_size
-       << " reached " << fixed << setprecision( 2 ) << gigabits_per_second << " Gbit/s.\n";
+  cout << "ByteStream (" << backend_name( backend ) << ") with capacity=" << capacity
+       << ", write_size=" << write_size << ", read_size=" << read_size << " reached " << fixed << setprecision( 2 )
+       << gigabits_per_second << " Gbit/s.\n";
+
+  debug_output << "             ByteStream (" << backend_name( backend ) << ") throughput: " << fixed
+               << setprecision( 2 ) << gigabits_per_second << " Gbit/s\n";
+
+  if ( gigabits_per_second < 0.1 ) {
+    throw runtime_error( "ByteStream did not meet minimum speed of 0.1 Gbit/s." );
+  }
+}
+
+// Small writes (e.g. an application writing line by line) that pile up in the stream, read back the
+// way TCPSender builds a segment: peek and pop view after view until `segment_size` bytes are gathered.
+void small_write_test( const ByteStream::Backend backend,
+                       const size_t input_len,    // NOLINT(bugprone-easily-swappable-parameters)
+                       const size_t capacity,     // NOLINT(bugprone-easily-swappable-parameters)
+                       const size_t random_seed,  // NOLINT(bugprone-easily-swappable-parameters)
+                       const size_t write_size,   // NOLINT(bugprone-easily-swappable-parameters)
+                       const size_t segment_size, // NOLINT(bugprone-easily-swappable-parameters)
+                       const uint64_t coalesce_size )
+{
+  const string data = [&random_seed, &input_len] {
+    default_random_engine rd { random_seed };
+    uniform_int_distribution<char> ud;
+    string ret;
+    for ( size_t i = 0; i < input_len; ++i ) {
+      ret += ud( rd );
+    }
+    return ret;
+  }();
+
+  ByteStream bs { capacity, backend };
+  bs.set_coalesce_size( coalesce_size );
+  string output_data;
+  output_data.reserve( data.size() );
+  string segment;
+  size_t views_per_segment = 0;
+  size_t segments = 0;
+  size_t written = 0;
+
+  const auto start_time = steady_clock::now();
+  while ( not bs.reader().is_finished() ) {
+    // the application writes until the stream is full
+    while ( written < data.size() and bs.writer().available_capacity() >= write_size ) {
+      bs.writer().push( data.substr( written, write_size ) );
+      written += write_size;
+    }
+    if ( written >= data.size() and not bs.writer().is_closed() ) {
+      bs.writer().close();
+    }
+
+    // the sender drains it one segment at a time
+    while ( bs.reader().bytes_buffered() ) {
+      segment.clear();
+      while ( segment.size() < segment_size and bs.reader().bytes_buffered() ) {
+        const auto view = bs.reader().peek().substr( 0, segment_size - segment.size() );
+        segment += view;
+        bs.reader().pop( view.size() );
+        ++views_per_segment;
+      }
+      output_data += segment;
+      ++segments;
+    }
+  }
+  const auto stop_time = steady_clock::now();
+
+  if ( data != output_data ) {
+    throw runtime_error( "Mismatch between data written and read" );
+  }
+
+  auto test_duration = duration_cast<duration<double>>( stop_time - start_time );
+  auto gigabits_per_second = 8 * static_cast<double>( input_len ) / test_duration.count() / 1e9;
 
-  debug_output << "             ByteStream throughput: " << fixed << setprecision( 2 ) << gigabits_per_second
-               << " Gbit/s\n";
+  cout << "ByteStream (" << backend_name( backend ) << ") with capacity=" << capacity
+       << ", write_size=" << write_size << ", segment_size=" << segment_size << ", coalesce_size=" << coalesce_size
+       << " reached " << fixed << setprecision( 2 ) << gigabits_per_second << " Gbit/s (" << setprecision( 1 )
+       << static_cast<double>( views_per_segment ) / static_cast<double>( segments ) << " views per segment).\n";
 
   if ( gigabits_per_second < 0.1 ) {
     throw runtime_error( "ByteStream did not meet minimum speed of 0.1 Gbit/s." );
@@ -88,7 +167,13 @@ void speed_test( const size_t input_len,   // NOLINT(bugprone-easily-swappable-p
 
 void program_body()
 {
-  speed_test( 1e7, 32768, 789, 1500, 128 );
+  speed_test( ByteStream::Backend::Chunked, 1e7, 32768, 789, 1500, 128 );
+  speed_test( ByteStream::Backend::Ring, 1e7, 32768, 789, 1500, 128 );
+
+  small_write_test( ByteStream::Backend::Chunked, 1e7, 32768, 789, 40, 1500, 0 );
+  small_write_test(
+    ByteStream::Backend::Chunked, 1e7, 32768, 789, 40, 1500, ByteStream::small_write_coalesce_size );
+  small_write_test( ByteStream::Backend::Ring, 1e7, 32768, 789, 40, 1500, 0 );
 }
 
 int main()
@@ -0,0 +1,125 @@
+#include "byte_stream.hh"
+
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+namespace {
+void expect( bool condition, const string& what )
+{
+  if ( not condition ) {
+    throw runtime_error( "splice: " + what );
+  }
+}
+
+string drain( Reader& reader )
+{
+  string out;
+  read( reader, reader.bytes_buffered(), out );
+  return out;
+}
+
+void whole_chunks_move()
+{
+  ByteStream from { 100 };
+  ByteStream to { 100 };
+  from.set_coalesce_size( 0 ); // keep each push in a chunk of its own
+
+  // long enough not to be stored inline in the string (where a move is a copy)
+  const string first( 30, 'h' );
+  const string second( 30, 'w' );
+  from.writer().push( first );
+  from.writer().push( second );
+  const char* const first_chunk = from.reader().peek().data();
+
+  expect( splice( from.reader(), to.writer(), 30 ) == 30, "return value" );
+  expect( to.reader().peek().data() == first_chunk, "a whole chunk changes owner without a copy" );
+  expect( from.reader().bytes_popped() == 30 and from.reader().bytes_buffered() == 30, "source counters" );
+  expect( to.writer().bytes_pushed() == 30 and to.writer().available_capacity() == 70, "destination counters" );
+
+  expect( splice( from.reader(), to.writer(), 100 ) == 30, "splice is limited by what is buffered" );
+  expect( from.reader().bytes_buffered() == 0, "source is empty" );
+  expect( drain( to.reader() ) == first + second, "contents" );
+}
+
+void partial_edges()
+{
+  ByteStream from { 100 };
+  ByteStream to { 100 };
+
+  from.writer().push( "abcdef" );
+  from.writer().push( "ghij" );
+  from.reader().pop( 2 );
+
+  // starts in the middle of one chunk and ends in the middle of the next
+  expect( splice( from.reader(), to.writer(), 6 ) == 6, "partial splice" );
+  expect( from.reader().peek() == "ij", "rest of the split chunk stays behind" );
+  expect( to.reader().bytes_buffered() == 6, "destination buffered" );
+  expect( drain( to.reader() ) == "cdefgh", "partial contents" );
+  expect( from.reader().bytes_popped() == 8 and to.writer().bytes_pushed() == 6, "counters after partial splice" );
+}
+
+void capacity_limit()
+{
+  ByteStream from { 100 };
+  ByteStream to { 7 };
+
+  from.writer().push( "0123" );
+  from.writer().push( "456789" );
+  to.writer().push( "xy" );
+
+  expect( splice( from.reader(), to.writer(), 100 ) == 5, "splice is limited by available capacity" );
+  expect( to.writer().available_capacity() == 0, "destination full" );
+  expect( from.reader().peek() == "56789", "source keeps what did not fit" );
+  expect( drain( to.reader() ) == "xy01234", "contents at capacity" );
+  expect( splice( from.reader(), to.writer(), 100 ) == 5, "more fits after popping" );
+  expect( drain( to.reader() ) == "56789", "rest of the contents" );
+}
+
+void ring_backends()
+{
+  for ( const auto from_backend : { ByteStream::Backend::Chunked, ByteStream::Backend::Ring } ) {
+    for ( const auto to_backend : { ByteStream::Backend::Chunked, ByteStream::Backend::Ring } ) {
+      ByteStream from { 4096, from_backend };
+      ByteStream to { 4096, to_backend };
+      string expected;
+
+      for ( int round = 0; round < 10; round++ ) {
+        const string data( 700 + round, static_cast<char>( 'a' + round ) );
+        from.writer().push( data );
+        expected += data;
+        splice( from.reader(), to.writer(), 500 );
+        if ( round % 3 == 2 ) {
+          to.reader().pop( 1000 );
+          expected.erase( 0, 1000 );
+        }
+      }
+      splice( from.reader(), to.writer(), 4096 );
+      expect( from.reader().bytes_buffered() == 0, "everything fits in the end" );
+
+      expect( from.reader().bytes_popped() == to.writer().bytes_pushed(), "counters agree across backends" );
+      string out = drain( to.reader() );
+      out += drain( from.reader() );
+      expect( out == expected, "contents across backends" );
+    }
+  }
+}
+} // namespace
+
+int main()
+{
+  try {
+    whole_chunks_move();
+    partial_edges();
+    capacity_limit();
+    ring_backends();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,139 @@
+#include "spsc_byte_stream.hh"
+
+#include "exception.hh"
+#include "random.hh"
+
+#include <exception>
+#include <iostream>
+#include <poll.h>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+using namespace std;
+
+namespace {
+void expect( bool condition, const string& what )
+{
+  if ( not condition ) {
+    throw runtime_error( "SPSCByteStream: " + what );
+  }
+}
+
+// Block until `fd` is readable (or a generous timeout expires, so a lost wakeup fails the test).
+void wait_for( optional<FileDescriptor>& fd )
+{
+  pollfd pfd { fd->fd_num(), POLLIN, 0 };
+  expect( CheckSystemCall( "poll", ::poll( &pfd, 1, 5000 ) ) == 1, "wakeup never arrived" );
+}
+
+void single_thread()
+{
+  SPSCByteStream bs { 8 };
+
+  bs.writer().push( "cat" );
+  bs.writer().push( "fish" );
+  expect( bs.writer().bytes_pushed() == 7, "bytes_pushed after two pushes" );
+  expect( bs.writer().available_capacity() == 1, "available_capacity after two pushes" );
+  expect( bs.reader().peek() == "catfish", "peek after two pushes" );
+
+  bs.writer().push( "dog" );
+  expect( bs.writer().bytes_pushed() == 8, "push is limited by capacity" );
+
+  bs.reader().pop( 5 );
+  expect( bs.reader().bytes_popped() == 5, "bytes_popped" );
+  expect( bs.reader().bytes_buffered() == 3, "bytes_buffered" );
+
+  bs.writer().push( "horse" );
+  expect( bs.reader().peek() == "shdhorse", "peek after more pushes" );
+  bs.writer().push( "cow" );
+  expect( bs.writer().bytes_pushed() == 13, "push into a full stream" );
+  expect( bs.reader().peek() == "shdhorse", "peek after a push into a full stream" );
+
+  bs.writer().close();
+  expect( bs.writer().is_closed(), "is_closed" );
+  expect( not bs.reader().is_finished(), "finished before popping everything" );
+  bs.reader().pop( 100 );
+  expect( bs.reader().is_finished(), "finished after popping everything" );
+  expect( bs.reader().bytes_popped() == 13, "bytes_popped at the end" );
+
+  // a stream with no capacity takes nothing
+  SPSCByteStream none { 0 };
+  none.writer().push( "cat" );
+  none.writer().push( "" );
+  expect( none.writer().bytes_pushed() == 0, "push with zero capacity" );
+  expect( none.reader().peek().empty(), "peek with zero capacity" );
+
+  // data that straddles the end of the ring is still peeked as one view
+  SPSCByteStream ring { 4096 };
+  ring.writer().push( string( 4000, 'x' ) );
+  ring.reader().pop( 4000 );
+  ring.writer().push( string( 200, 'y' ) );
+  expect( ring.reader().peek() == string( 200, 'y' ), "peek across the wrap" );
+}
+
+void two_threads()
+{
+  constexpr size_t total = 4'000'000;
+  constexpr uint64_t capacity = 4096;
+
+  string data;
+  data.reserve( total );
+  auto rd = get_random_engine();
+  for ( size_t i = 0; i < total; i++ ) {
+    data.push_back( static_cast<char>( rd() ) );
+  }
+
+  SPSCByteStream bs { capacity, true };
+
+  thread producer { [&] {
+    auto write_rd = get_random_engine();
+    size_t offset = 0;
+    while ( offset < data.size() ) {
+      bs.writer().clear_wakeup();
+      if ( bs.writer().available_capacity() == 0 ) {
+        wait_for( bs.writable_fd() );
+        continue;
+      }
+      const size_t len = min( data.size() - offset, 1 + write_rd() % 3000 );
+      const uint64_t before = bs.writer().bytes_pushed();
+      bs.writer().push( string_view { data }.substr( offset, len ) );
+      offset += bs.writer().bytes_pushed() - before;
+    }
+    bs.writer().close();
+  } };
+
+  string output;
+  output.reserve( total );
+  while ( not bs.reader().is_finished() ) {
+    bs.reader().clear_wakeup();
+    if ( bs.reader().bytes_buffered() == 0 ) {
+      if ( not bs.reader().is_finished() ) {
+        wait_for( bs.readable_fd() );
+      }
+      continue;
+    }
+    const auto view = bs.reader().peek();
+    output += view;
+    bs.reader().pop( view.size() );
+  }
+  producer.join();
+
+  expect( output == data, "bytes differ after cross-thread transfer" );
+  expect( bs.reader().bytes_popped() == total, "bytes_popped after cross-thread transfer" );
+}
+} // namespace
+
+int main()
+{
+  try {
+    single_thread();
+    two_threads();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -3,9 +3,11 @@
 #include "byte_stream.hh"
 #include "common.hh"
 
+#include <algorithm>
 #include <concepts>
 #include <optional>
 #include <utility>
+#include <vector>
 
 static_assert( sizeof( Reader ) == sizeof( ByteStream ),
                "Please add member variables to the ByteStream base, not the ByteStream Reader." );
@@ -16,8 +18,13 @@ static_assert( sizeof( Writer ) == sizeof( ByteStream ),
 class ByteStreamTestHarness : public TestHarness<ByteStream>
 {
 public:
-  ByteStreamTestHarness( std::string test_name, uint64_t capacity )
-    : TestHarness( move( test_name ), "capacity=" + std::to_string( capacity ), ByteStream { capacity } )
+  ByteStreamTestHarness( std::string test_name,
+                         uint64_t capacity,
+                         ByteStream::Backend backend = ByteStream::Backend::Chunked )
+    : TestHarness( move( test_name ),
+                   "capacity=" + std::to_string( capacity )
+                     + ( backend == ByteStream::Backend::Ring ? ", backend=ring" : "" ),
+                   ByteStream { capacity, backend } )
   {}
 
   size_t peek_size() { return object().reader().peek().size(); }
@@ -46,6 +53,24 @@ struct SetError : public Action<ByteStream>
   void execute( ByteStream& bs ) const override { bs.set_error(); }
 };
 
+struct SetCoalesceSize : public Action<ByteStream>
+{
+  uint64_t size_;
+
+  explicit SetCoalesceSize( uint64_t size ) : size_( size ) {}
+  std::string description() const override { return "set_coalesce_size( " + std::to_string( size_ ) + " )"; }
+  void execute( ByteStream& bs ) const override { bs.set_coalesce_size( size_ ); }
+};
+
+struct GrowCapacity : public Action<ByteStream>
+{
+  uint64_t capacity_;
+
+  explicit GrowCapacity( uint64_t capacity ) : capacity_( capacity ) {}
+  std::string description() const override { return "grow_capacity( " + std::to_string( capacity_ ) + " )"; }
+  void execute( ByteStream& bs ) const override { bs.writer().grow_capacity( capacity_ ); }
+};
+
 struct Pop : public Action<ByteStream>
 {
   size_t len_;
@@ -55,6 +80,29 @@ struct Pop : public Action<ByteStream>
   void execute( ByteStream& bs ) const override { bs.reader().pop( len_ ); }
 };
 
+struct ReserveCommit : public Action<ByteStream>
+{
+  uint64_t reserve_len_;
+  std::string data_;
+
+  ReserveCommit( uint64_t reserve_len, std::string data ) : reserve_len_( reserve_len ), data_( move( data ) ) {}
+  std::string description() const override
+  {
+    return "reserve( " + std::to_string( reserve_len_ ) + " ), write \"" + Printer::prettify( data_ )
+           + "\" there, commit( " + std::to_string( data_.size() ) + " )";
+  }
+  void execute( ByteStream& bs ) const override
+  {
+    const auto space = bs.writer().reserve( reserve_len_ );
+    if ( space.size() < data_.size() ) {
+      throw ExpectationViolation { "Writer::reserve() returned only " + std::to_string( space.size() )
+                                   + " bytes of space" };
+    }
+    std::copy( data_.begin(), data_.end(), space.begin() );
+    bs.writer().commit( data_.size() );
+  }
+};
+
 /* expectations */
 
 struct Peek : public Expectation<ByteStream>
@@ -107,6 +155,83 @@ struct PeekOnce : public Peek
   }
 };
 
+struct PeekViews : public Expectation<ByteStream>
+{
+  size_t max_views_;
+  std::vector<std::string> output_;
+
+  PeekViews( size_t max_views, std::vector<std::string> output )
+    : max_views_( max_views ), output_( std::move( output ) )
+  {}
+
+  std::string description() const override
+  {
+    std::string desc = "peek_views( " + std::to_string( max_views_ ) + " ) gives {";
+    for ( const auto& x : output_ ) {
+      desc += " \"" + Printer::prettify( x ) + "\"";
+    }
+    return desc + " }";
+  }
+
+  void execute( ByteStream& bs ) const override
+  {
+    const auto views = bs.reader().peek_views( max_views_ );
+    if ( views.size() != output_.size() ) {
+      throw ExpectationViolation { "Expected " + std::to_string( output_.size() ) + " views from peek_views(), "
+                                   + "but got " + std::to_string( views.size() ) };
+    }
+    for ( size_t i = 0; i < views.size(); i++ ) {
+      if ( views[i] != output_[i] ) {
+        throw ExpectationViolation { "Expected view " + std::to_string( i ) + " to be \""
+                                     + Printer::prettify( output_[i] ) + "\", but found \""
+                                     + Printer::prettify( views[i] ) + "\"" };
+      }
+    }
+  }
+};
+
+struct PeekAt : public Expectation<ByteStream>
+{
+  uint64_t offset_;
+  std::string output_;
+
+  PeekAt( uint64_t offset, std::string output ) : offset_( offset ), output_( std::move( output ) ) {}
+
+  std::string description() const override
+  {
+    return "peek_at( " + std::to_string( offset_ ) + " ) gives \"" + Printer::prettify( output_ ) + "\"";
+  }
+
+  void execute( ByteStream& bs ) const override
+  {
+    const auto view = bs.reader().peek_at( offset_ );
+    if ( view != output_ ) {
+      throw ExpectationViolation { "Expected \"" + Printer::prettify( output_ ) + "\" from peek_at(), but found \""
+                                   + Printer::prettify( view ) + "\"" };
+    }
+  }
+};
+
+struct Reservable : public Expectation<ByteStream>
+{
+  uint64_t reserve_len_;
+  uint64_t expected_;
+
+  Reservable( uint64_t reserve_len, uint64_t expected ) : reserve_len_( reserve_len ), expected_( expected ) {}
+  std::string description() const override
+  {
+    return "reserve( " + std::to_string( reserve_len_ ) + " ) gives " + std::to_string( expected_ ) + " bytes";
+  }
+  void execute( ByteStream& bs ) const override
+  {
+    const auto got = bs.writer().reserve( reserve_len_ ).size();
+    bs.writer().commit( 0 );
+    if ( got != expected_ ) {
+      throw ExpectationViolation { "reserved space", expected_, got };
+    }
+  }
+};
+
 struct IsClosed : public ConstExpectBool<ByteStream>
 {
   using ConstExpectBool::ConstExpectBool;
@@ -0,0 +1,116 @@
+#include "byte_stream.hh"
+#include "reassembler.hh"
+#include "tcp_receiver_message.hh"
+#include "tcp_sender.hh"
+
+#include <cstddef>
+#include <exception>
+#include <iostream>
+#include <memory_resource>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+namespace {
+void expect( bool condition, const string& what )
+{
+  if ( not condition ) {
+    throw runtime_error( "arena: " + what );
+  }
+}
+
+// Forwards to the default resource, counting what goes through it.
+class CountingResource : public pmr::memory_resource
+{
+public:
+  size_t allocations() const { return allocations_; }
+  size_t outstanding() const { return outstanding_; }
+
+private:
+  size_t allocations_ { 0 };
+  size_t outstanding_ { 0 };
+
+  void* do_allocate( size_t bytes, size_t alignment ) override
+  {
+    ++allocations_;
+    outstanding_ += bytes;
+    return pmr::new_delete_resource()->allocate( bytes, alignment );
+  }
+
+  void do_deallocate( void* ptr, size_t bytes, size_t alignment ) override
+  {
+    outstanding_ -= bytes;
+    pmr::new_delete_resource()->deallocate( ptr, bytes, alignment );
+  }
+
+  bool do_is_equal( const pmr::memory_resource& other ) const noexcept override { return this == &other; }
+};
+
+void reassembler_uses_arena()
+{
+  CountingResource arena;
+  {
+    Reassembler reassembler { ByteStream { 1000 }, Reassembler::Mode::Extents, &arena };
+    for ( uint64_t i = 10; i < 100; i += 10 ) {
+      reassembler.insert( i, string( 5, 'x' ), false );
+    }
+    expect( reassembler.bytes_pending() == 45, "pending bytes" );
+    expect( arena.allocations() >= 9, "pending extents are allocated from the arena" );
+
+    reassembler.insert( 0, string( 100, 'y' ), true );
+    expect( reassembler.reader().bytes_buffered() == 100, "reassembled every byte" );
+    expect( reassembler.writer().is_closed(), "stream closed" );
+    expect( arena.outstanding() == 0, "merged extents go back to the arena" );
+  }
+  expect( arena.outstanding() == 0, "nothing left in the arena" );
+}
+
+void sender_uses_arena()
+{
+  CountingResource arena;
+  {
+    TCPSender sender { ByteStream { 10000 }, Wrap32 { 0 }, 1000, &arena };
+    sender.push( []( const TCPSenderMessage& ) {} );
+    expect( arena.allocations() >= 1, "outstanding SYN is queued in the arena" );
+
+    sender.receive( TCPReceiverMessage { Wrap32 { 1 }, 5000, false } );
+    sender.writer().push( string( 3000, 'z' ) );
+    sender.push( []( const TCPSenderMessage& ) {} );
+    expect( sender.sequence_numbers_in_flight() == 3000, "segments in flight" );
+    expect( arena.outstanding() > 0, "outstanding segments are queued in the arena" );
+  }
+  expect( arena.outstanding() == 0, "nothing left in the arena" );
+}
+
+void unsynchronized_pool_arena()
+{
+  // the arena TCPPeer uses: a connection's bookkeeping is released in one go when it goes away
+  CountingResource upstream;
+  {
+    pmr::unsynchronized_pool_resource arena { &upstream };
+    Reassembler reassembler { ByteStream { 100000 }, Reassembler::Mode::Extents, &arena };
+    TCPSender sender { ByteStream { 100000 }, Wrap32 { 0 }, 1000, &arena };
+    for ( uint64_t i = 1; i < 1000; i += 2 ) {
+      reassembler.insert( i, "x", false );
+    }
+    sender.push( []( const TCPSenderMessage& ) {} );
+    expect( upstream.outstanding() > 0, "the pool draws from its upstream resource" );
+  }
+  expect( upstream.outstanding() == 0, "the pool returns everything to its upstream resource" );
+}
+} // namespace
+
+int main()
+{
+  try {
+    reassembler_uses_arena();
+    sender_uses_arena();
+    unsynchronized_pool_arena();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
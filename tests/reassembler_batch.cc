@@ -0,0 +1,151 @@
+#include "random.hh"
+#include "reassembler.hh"
+#include "tcp_receiver.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+void expect( bool condition, const string& what )
+{
+  if ( not condition ) {
+    throw runtime_error( "insert_batch: " + what );
+  }
+}
+
+// Feed the same random, overlapping, reordered segments to insert() one at a time and to insert_batch()
+// in random-sized batches, and check that the two agree after every batch.
+void compare_with_insert( Reassembler::Mode mode, uint64_t capacity )
+{
+  auto rd = get_random_engine();
+  Reassembler single { ByteStream { capacity }, mode };
+  Reassembler batched { ByteStream { capacity }, mode };
+
+  string data( capacity * 20, 0 );
+  generate( data.begin(), data.end(), [&] { return rd(); } );
+  string out_single;
+  string out_batched;
+
+  for ( int step = 0; step < 1000 and not single.reader().is_finished(); step++ ) {
+    vector<Reassembler::Segment> batch;
+    const uint64_t base = single.writer().bytes_pushed();
+    for ( auto n = 1 + rd() % 8; n > 0; n-- ) {
+      const uint64_t first = min<uint64_t>( data.size() - 1, base + rd() % ( capacity + capacity / 4 ) );
+      const uint64_t len = min<uint64_t>( data.size() - first, 1 + rd() % ( capacity / 3 ) );
+      const bool last = first + len == data.size();
+      single.insert( first, data.substr( first, len ), last );
+      batch.push_back( { first, data.substr( first, len ), last } );
+    }
+    batched.insert_batch( batch );
+
+    expect( single.writer().bytes_pushed() == batched.writer().bytes_pushed(),
+            "bytes pushed differ at step " + to_string( step ) );
+    expect( single.bytes_pending() == batched.bytes_pending(),
+            "bytes pending differ at step " + to_string( step ) );
+    expect( single.reader().is_finished() == batched.reader().is_finished(),
+            "finished differs at step " + to_string( step ) );
+
+    if ( rd() % 3 == 0 ) {
+      string chunk;
+      read( single.reader(), rd() % capacity, chunk );
+      out_single += chunk;
+      read( batched.reader(), chunk.size(), chunk );
+      out_batched += chunk;
+    }
+  }
+
+  string rest;
+  read( single.reader(), capacity, rest );
+  out_single += rest;
+  read( batched.reader(), capacity, rest );
+  out_batched += rest;
+  expect( out_single == out_batched and out_batched == data.substr( 0, out_batched.size() ), "different bytes" );
+}
+
+// In-order segments that each go out as their own write through insert() become one write.
+void single_push( Reassembler::Mode mode )
+{
+  Reassembler reassembler { ByteStream { 100000 }, mode };
+  vector<Reassembler::Segment> batch;
+  for ( uint64_t i = 10; i > 0; i-- ) {
+    batch.push_back( { ( i - 1 ) * 1000, string( 1000, static_cast<char>( 'a' + i ) ), i == 10 } );
+  }
+  reassembler.insert_batch( batch );
+  expect( reassembler.reader().bytes_buffered() == 10000, "every byte is pushed" );
+  expect( reassembler.reader().peek().size() == 10000, "the batch is pushed as one chunk" );
+  expect( reassembler.writer().is_closed(), "the last segment closes the stream" );
+}
+
+// A last segment that doesn't fit in the window doesn't end the stream, whichever way it arrives.
+void last_beyond_window( Reassembler::Mode mode )
+{
+  Reassembler single { ByteStream { 2 }, mode };
+  single.insert( 0, "ab", false );
+  single.insert( 2, "c", true );
+  expect( not single.writer().is_closed(), "insert: dropped last segment leaves the stream open" );
+
+  Reassembler batched { ByteStream { 2 }, mode };
+  vector<Reassembler::Segment> batch;
+  batch.push_back( { 1, "bc", true } );
+  batch.push_back( { 0, "a", false } );
+  batched.insert_batch( batch );
+  expect( not batched.writer().is_closed(), "insert_batch: truncated last segment leaves the stream open" );
+
+  string out;
+  read( batched.reader(), 2, out );
+  batch.clear();
+  batch.push_back( { 2, "c", true } );
+  batched.insert_batch( batch );
+  expect( batched.writer().is_closed(), "retransmitted last segment closes the stream" );
+}
+
+// receive_batch() ends up in the same state as receive() on each message.
+void receiver_batch()
+{
+  const Wrap32 isn { 1234567 };
+  const string data = "the quick brown fox jumps over the lazy dog";
+  vector<TCPSenderMessage> messages;
+  messages.push_back( { isn, true, data.substr( 0, 5 ), false, false } );
+  for ( uint64_t i = 5; i < data.size(); i += 7 ) {
+    messages.push_back( { isn + 1 + i, false, data.substr( i, 7 ), i + 7 >= data.size(), false } );
+  }
+  reverse( messages.begin() + 1, messages.end() );
+
+  TCPReceiver single { Reassembler { ByteStream { 1000 } } };
+  for ( const auto& message : messages ) {
+    single.receive( message );
+  }
+  TCPReceiver batched { Reassembler { ByteStream { 1000 } } };
+  batched.receive_batch( messages );
+
+  expect( batched.reader().peek() == data, "receive_batch reassembles the stream" );
+  expect( batched.writer().is_closed(), "receive_batch sees the FIN" );
+  expect( batched.send().ackno == single.send().ackno, "same ackno as receive()" );
+  expect( batched.send().window_size == single.send().window_size, "same window as receive()" );
+}
+} // namespace
+
+int main()
+{
+  try {
+    for ( const auto mode : { Reassembler::Mode::Extents, Reassembler::Mode::Window } ) {
+      compare_with_insert( mode, 64 );
+      compare_with_insert( mode, 1000 );
+      single_push( mode );
+      last_beyond_window( mode );
+    }
+    receiver_batch();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,323 @@
+#include "reassembler.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+/*
+ * reassembler_benchmark: feeds the same adversarial arrival patterns to each Reassembler mode and
+ * reports throughput, the peak of bytes_pending(), and heap allocations per inserted segment.
+ * Every pattern is generated before the clock starts, and the output is drained after every
+ * insert, so the modes are compared on equal terms. Like byte_stream_benchmark it has no
+ * pass/fail threshold beyond checking that the stream comes out intact.
+ *
+ * Usage: reassembler_benchmark [--format=table|json|csv] [--output=FILE] [--bytes=N] [--quick]
+ */
+
+namespace {
+// Every operator new in the process goes through these, so the timed loop can count allocations.
+size_t allocation_count = 0; // NOLINT(*-avoid-non-const-global-variables)
+} // namespace
+
+void* operator new( size_t size )
+{
+  ++allocation_count;
+  if ( void* ptr = malloc( size ) ) { // NOLINT(*-no-malloc, *-owning-memory)
+    return ptr;
+  }
+  throw bad_alloc {};
+}
+
+void operator delete( void* ptr ) noexcept
+{
+  free( ptr ); // NOLINT(*-no-malloc, *-owning-memory)
+}
+
+void operator delete( void* ptr, size_t /* size */ ) noexcept
+{
+  free( ptr ); // NOLINT(*-no-malloc, *-owning-memory)
+}
+
+// std::pmr::new_delete_resource() (behind the extent map) allocates through the aligned forms.
+void* operator new( size_t size, align_val_t alignment )
+{
+  ++allocation_count;
+  const auto align = static_cast<size_t>( alignment );
+  if ( void* ptr = aligned_alloc( align, ( size + align - 1 ) / align * align ) ) { // NOLINT(*-owning-memory)
+    return ptr;
+  }
+  throw bad_alloc {};
+}
+
+void operator delete( void* ptr, align_val_t /* alignment */ ) noexcept
+{
+  free( ptr ); // NOLINT(*-no-malloc, *-owning-memory)
+}
+
+void operator delete( void* ptr, size_t /* size */, align_val_t /* alignment */ ) noexcept
+{
+  free( ptr ); // NOLINT(*-no-malloc, *-owning-memory)
+}
+
+namespace {
+constexpr size_t capacity = 15000;
+constexpr size_t segment_size = 1500;
+
+struct Segment
+{
+  uint64_t first_index;
+  string data;
+  bool is_last;
+};
+
+struct Pattern
+{
+  string name;
+  vector<Segment> segments;
+};
+
+struct Result
+{
+  string pattern;
+  Reassembler::Mode mode;
+  size_t segments;
+  double gigabits_per_second;
+  uint64_t peak_pending;
+  double allocations_per_segment;
+};
+
+string_view mode_name( Reassembler::Mode mode )
+{
+  return mode == Reassembler::Mode::Window ? "window" : "extents";
+}
+
+string make_data( size_t len )
+{
+  default_random_engine rd { 1370 };
+  uniform_int_distribution<char> ud;
+  string ret;
+  ret.reserve( len );
+  for ( size_t i = 0; i < len; ++i ) {
+    ret += ud( rd );
+  }
+  return ret;
+}
+
+// Appends the segment [first, first + len) of `data`, clipped to its end.
+void add( vector<Segment>& segments, const string& data, size_t first, size_t len )
+{
+  len = min( len, data.size() - first );
+  segments.push_back( { first, data.substr( first, len ), first + len == data.size() } );
+}
+
+// Every pattern delivers the stream one window (`capacity` bytes) at a time, since nothing past the
+// window can be kept; what differs is the order and shape of the segments inside each window.
+vector<Pattern> make_patterns( const string& data )
+{
+  vector<Pattern> patterns;
+  default_random_engine rd { 1370 };
+
+  auto& in_order = patterns.emplace_back( Pattern { "in order", {} } ).segments;
+  for ( size_t i = 0; i < data.size(); i += segment_size ) {
+    add( in_order, data, i, segment_size );
+  }
+
+  auto& reverse_order = patterns.emplace_back( Pattern { "reverse", {} } ).segments;
+  for ( size_t window = 0; window < data.size(); window += capacity ) {
+    for ( size_t i = min( window + capacity, data.size() ); i > window; ) {
+      i -= min( segment_size, i - window );
+      add( reverse_order, data, i, segment_size );
+    }
+  }
+
+  auto& permutation = patterns.emplace_back( Pattern { "permutation", {} } ).segments;
+  for ( size_t window = 0; window < data.size(); window += capacity ) {
+    const auto start = permutation.size();
+    for ( size_t i = window; i < min( window + capacity, data.size() ); i += segment_size ) {
+      add( permutation, data, i, segment_size );
+    }
+    shuffle( permutation.begin() + static_cast<ptrdiff_t>( start ), permutation.end(), rd );
+  }
+
+  auto& holes = patterns.emplace_back( Pattern { "1-byte holes", {} } ).segments;
+  for ( size_t window = 0; window < data.size(); window += capacity ) {
+    for ( size_t i = window + 1; i < min( window + capacity, data.size() ); i += 2 ) {
+      add( holes, data, i, 1 );
+    }
+    add( holes, data, window, capacity );
+  }
+
+  auto& duplicates = patterns.emplace_back( Pattern { "duplication", {} } ).segments;
+  for ( size_t window = 0; window < data.size(); window += capacity ) {
+    const auto start = duplicates.size();
+    for ( size_t i = window; i < min( window + capacity, data.size() ); i += segment_size ) {
+      for ( int copy = 0; copy < 4; ++copy ) {
+        add( duplicates, data, i, segment_size );
+      }
+    }
+    shuffle( duplicates.begin() + static_cast<ptrdiff_t>( start ), duplicates.end(), rd );
+  }
+
+  auto& tail_first = patterns.emplace_back( Pattern { "tail first", {} } ).segments;
+  for ( size_t window = 0; window < data.size(); window += capacity ) {
+    const size_t end = min( window + capacity, data.size() );
+    const size_t tail = end - min( segment_size, end - window );
+    add( tail_first, data, tail, segment_size ); // carries the FIN in the last window
+    for ( size_t i = window; i < tail; i += segment_size ) {
+      add( tail_first, data, i, min( segment_size, tail - i ) );
+    }
+  }
+
+  // each segment reaches a full window past its start, so every insert is cut at the window's edge
+  auto& truncation = patterns.emplace_back( Pattern { "edge truncation", {} } ).segments;
+  for ( size_t i = 0; i < data.size(); i += segment_size ) {
+    add( truncation, data, i, capacity + segment_size );
+  }
+
+  return patterns;
+}
+
+Result run( const Pattern& pattern, Reassembler::Mode mode, const string& data )
+{
+  Result result { pattern.name, mode, pattern.segments.size(), 0, 0, 0 };
+  vector<Segment> segments = pattern.segments;
+  Reassembler reassembler { ByteStream { capacity }, mode };
+  string output;
+  output.reserve( data.size() );
+
+  const size_t allocations_before = allocation_count;
+  const auto start = steady_clock::now();
+  for ( auto& segment : segments ) {
+    reassembler.insert( segment.first_index, move( segment.data ), segment.is_last );
+    result.peak_pending = max( result.peak_pending, reassembler.bytes_pending() );
+    while ( reassembler.reader().bytes_buffered() ) {
+      const auto view = reassembler.reader().peek();
+      output.append( view );
+      reassembler.reader().pop( view.size() );
+    }
+  }
+  const auto elapsed = duration<double>( steady_clock::now() - start ).count();
+  const size_t allocations = allocation_count - allocations_before;
+
+  if ( not reassembler.reader().is_finished() ) {
+    throw runtime_error( pattern.name + ": Reassembler did not close ByteStream when finished" );
+  }
+  if ( output != data ) {
+    throw runtime_error( pattern.name + ": mismatch between data written and read" );
+  }
+  result.gigabits_per_second = 8 * static_cast<double>( data.size() ) / elapsed / 1e9;
+  result.allocations_per_segment = static_cast<double>( allocations ) / static_cast<double>( segments.size() );
+  return result;
+}
+
+void print_table( ostream& out, const vector<Result>& results )
+{
+  out << left << setw( 17 ) << "pattern" << setw( 9 ) << "mode" << right << setw( 10 ) << "segments" << setw( 9 )
+      << "Gbit/s" << setw( 14 ) << "peak pending" << setw( 14 ) << "allocs/seg\n";
+  for ( const auto& r : results ) {
+    out << left << setw( 17 ) << r.pattern << setw( 9 ) << mode_name( r.mode ) << right << setw( 10 ) << r.segments
+        << fixed << setprecision( 2 ) << setw( 9 ) << r.gigabits_per_second << setw( 14 ) << r.peak_pending
+        << setw( 13 ) << r.allocations_per_segment << "\n";
+  }
+}
+
+void print_csv( ostream& out, const vector<Result>& results )
+{
+  out << "pattern,mode,segments,gbit_per_s,peak_pending,allocs_per_segment\n";
+  for ( const auto& r : results ) {
+    out << r.pattern << "," << mode_name( r.mode ) << "," << r.segments << "," << r.gigabits_per_second << ","
+        << r.peak_pending << "," << r.allocations_per_segment << "\n";
+  }
+}
+
+void print_json( ostream& out, const vector<Result>& results )
+{
+  out << "[\n";
+  for ( size_t i = 0; i < results.size(); ++i ) {
+    const auto& r = results[i];
+    out << "  {\"pattern\": \"" << r.pattern << "\", \"mode\": \"" << mode_name( r.mode )
+        << "\", \"segments\": " << r.segments << ", \"gbit_per_s\": " << r.gigabits_per_second
+        << ", \"peak_pending\": " << r.peak_pending << ", \"allocs_per_segment\": " << r.allocations_per_segment
+        << "}" << ( i + 1 < results.size() ? "," : "" ) << "\n";
+  }
+  out << "]\n";
+}
+
+void program_body( const vector<string>& args )
+{
+  string format = "table";
+  string output_path;
+  size_t bytes = 3'000'000;
+
+  for ( const auto& arg : args ) {
+    if ( arg.starts_with( "--format=" ) ) {
+      format = arg.substr( 9 );
+    } else if ( arg.starts_with( "--output=" ) ) {
+      output_path = arg.substr( 9 );
+    } else if ( arg.starts_with( "--bytes=" ) ) {
+      bytes = stoul( arg.substr( 8 ) );
+    } else if ( arg == "--quick" ) {
+      bytes = 300'000;
+    } else {
+      throw runtime_error( "usage: reassembler_benchmark [--format=table|json|csv] [--output=FILE] "
+                           "[--bytes=N] [--quick]" );
+    }
+  }
+  if ( format != "table" and format != "json" and format != "csv" ) {
+    throw runtime_error( "unknown format: " + format );
+  }
+  if ( bytes == 0 ) {
+    throw runtime_error( "--bytes must be positive" );
+  }
+
+  const string data = make_data( bytes );
+  const vector<Pattern> patterns = make_patterns( data );
+  vector<Result> results;
+  for ( const auto& pattern : patterns ) {
+    for ( const auto mode : { Reassembler::Mode::Extents, Reassembler::Mode::Window } ) {
+      results.push_back( run( pattern, mode, data ) );
+    }
+  }
+
+  ofstream file;
+  if ( not output_path.empty() ) {
+    file.open( output_path );
+    if ( not file ) {
+      throw runtime_error( "could not open " + output_path );
+    }
+  }
+  ostream& out = output_path.empty() ? cout : file;
+
+  if ( format == "json" ) {
+    print_json( out, results );
+  } else if ( format == "csv" ) {
+    print_csv( out, results );
+  } else {
+    print_table( out, results );
+  }
+}
+} // namespace
+
+int main( int argc, char* argv[] )
+{
+  try {
+    program_body( { argv + 1, argv + argc } );
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,112 @@
+#include "reassembler.hh"
+#include "reassembly_budget.hh"
+#include "tcp_receiver.hh"
+
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+using namespace std;
+
+namespace {
+void expect( bool condition, const string& what )
+{
+  if ( not condition ) {
+    throw runtime_error( "ReassemblyBudget: " + what );
+  }
+}
+
+string letters( uint64_t first, uint64_t len )
+{
+  string ret;
+  for ( uint64_t i = first; i < first + len; i++ ) {
+    ret += static_cast<char>( 'a' + i % 26 );
+  }
+  return ret;
+}
+
+void shared_limit()
+{
+  auto budget = make_shared<ReassemblyBudget>( 1000 );
+  Reassembler a { ByteStream { 10000 } };
+  Reassembler b { ByteStream { 10000 } };
+  a.set_budget( budget );
+  b.set_budget( budget );
+
+  a.insert( 100, letters( 100, 400 ), false );
+  a.insert( 600, letters( 600, 400 ), false );
+  expect( budget->used() == 800, "first connection is charged for what it stores" );
+
+  // the second connection only gets what is left, and drops its farthest bytes
+  b.insert( 100, letters( 100, 200 ), false );
+  b.insert( 400, letters( 400, 200 ), false );
+  b.insert( 700, letters( 700, 100 ), false );
+  expect( budget->used() == 1000, "the budget is never exceeded" );
+  expect( b.bytes_pending() == 200, "second connection keeps what the budget grants" );
+  expect( b.bytes_evicted() == 300, "second connection evicts the rest" );
+  expect( budget->bytes_evicted() == 300 and budget->evictions() == 2, "the budget counts evictions" );
+  expect( a.bytes_pending() == 800 and a.bytes_evicted() == 0, "first connection is untouched" );
+
+  // what was kept is the part nearest to the next byte needed
+  b.insert( 0, letters( 0, 100 ), false );
+  expect( b.reader().peek() == letters( 0, 300 ), "nearest bytes were kept" );
+  expect( b.bytes_pending() == 0 and budget->used() == 800, "assembled bytes are credited back" );
+
+  a.insert( 0, letters( 0, 1000 ), false );
+  expect( budget->used() == 0, "all bytes credited back" );
+}
+
+void eviction_forgets_last()
+{
+  auto budget = make_shared<ReassemblyBudget>( 100 );
+  Reassembler r { ByteStream { 10000 } };
+  r.set_budget( budget );
+
+  r.insert( 50, letters( 50, 150 ), true );
+  expect( r.bytes_pending() == 100 and r.bytes_evicted() == 50, "tail evicted" );
+  r.insert( 0, letters( 0, 50 ), false );
+  expect( r.reader().bytes_buffered() == 150, "kept bytes assembled" );
+  expect( not r.writer().is_closed(), "the end of the stream was evicted, so the stream stays open" );
+  r.insert( 150, letters( 150, 50 ), true );
+  string assembled;
+  read( r.reader(), 200, assembled );
+  expect( r.writer().is_closed() and assembled == letters( 0, 200 ), "retransmitted tail closes it" );
+}
+
+void returned_on_destruction()
+{
+  auto budget = make_shared<ReassemblyBudget>( 1000 );
+  {
+    Reassembler r { ByteStream { 10000 } };
+    r.set_budget( budget );
+    r.insert( 10, letters( 10, 300 ), false );
+
+    // the charge moves with the Reassembler
+    TCPReceiver receiver { move( r ) };
+    expect( budget->used() == 300, "moving keeps the charge" );
+  }
+  expect( budget->used() == 0, "charge returned when the Reassembler is destroyed" );
+
+  Reassembler windowed { ByteStream { 10000 }, Reassembler::Mode::Window };
+  windowed.set_budget( budget );
+  windowed.insert( 10, letters( 10, 300 ), false );
+  expect( budget->used() == 0 and windowed.bytes_pending() == 300, "window mode is not charged" );
+}
+} // namespace
+
+int main()
+{
+  try {
+    shared_limit();
+    eviction_forgets_last();
+    returned_on_destruction();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -13,9 +13,13 @@
 using namespace std;
 using namespace std::chrono;
 
-void speed_test( const size_t num_chunks,   // NOLINT(bugprone-easily-swappable-parameters)
-                 const size_t capacity,     // NOLINT(bugprone-easily-swappable-parameters)
-                 const size_t random_seed ) // NOLINT(bugprone-easily-swappable-parameters)
+// Pattern "overlap": each window of `capacity` bytes arrives as three overlapping, reordered copies.
+// Pattern "holes": every other `piece`-byte piece of a window arrives first, then the whole window.
+void speed_test( const size_t num_chunks,  // NOLINT(bugprone-easily-swappable-parameters)
+                 const size_t capacity,    // NOLINT(bugprone-easily-swappable-parameters)
+                 const size_t random_seed, // NOLINT(bugprone-easily-swappable-parameters)
+                 const size_t piece = 0,   // NOLINT(bugprone-easily-swappable-parameters)
+                 const Reassembler::Mode mode = Reassembler::Mode::Extents )
 {
   // Generate the data to be written
   const string data = [&] {
@@ -31,12 +35,19 @@ void speed_test( const size_t num_chunks,   // NOLINT(bugprone-easily-swappable-
   // Split the data into segments before writing
   queue<tuple<uint64_t, string, bool>> split_data;
   for ( size_t i = 0; i < data.size(); i += capacity ) {
-    split_data.emplace( i + 2, data.substr( i + 2, capacity * 2 ), i + 2 + capacity * 2 >= data.size() );
-    split_data.emplace( i, data.substr( i, capacity * 2 ), i + capacity * 2 >= data.size() );
-    split_data.emplace( i + 1, data.substr( i + 1, capacity * 2 ), i + 1 + capacity * 2 >= data.size() );
+    if ( piece == 0 ) {
+      split_data.emplace( i + 2, data.substr( i + 2, capacity * 2 ), i + 2 + capacity * 2 >= data.size() );
+      split_data.emplace( i, data.substr( i, capacity * 2 ), i + capacity * 2 >= data.size() );
+      split_data.emplace( i + 1, data.substr( i + 1, capacity * 2 ), i + 1 + capacity * 2 >= data.size() );
+    } else {
+      for ( size_t j = i + piece; j < i + capacity; j += 2 * piece ) {
+        split_data.emplace( j, data.substr( j, piece ), false );
+      }
+      split_data.emplace( i, data.substr( i, capacity ), i + capacity >= data.size() );
+    }
   }
 
-  Reassembler reassembler { ByteStream { capacity } };
+  Reassembler reassembler { ByteStream { capacity }, mode };
 
   string output_data;
   output_data.reserve( data.size() );
@@ -71,7 +82,9 @@ void speed_test( const size_t num_chunks,   // NOLINT(bugprone-easily-swappable-
   fstream debug_output;
   debug_output.open( "/dev/tty" );
 
-  cout << "Reassembler to ByteStream with capacity=" << capacity << " reached " << fixed << setprecision( 2 )
+  cout << "Reassembler (" << ( mode == Reassembler::Mode::Window ? "window" : "extents" )
+       << ") to ByteStream with capacity=" << capacity << ", pattern="
+       << ( piece == 0 ? "overlap" : "holes of " + to_string( piece ) ) << " reached " << fixed << setprecision( 2 )
        << gigabits_per_second << " Gbit/s.\n";
 
   debug_output << "             Reassembler throughput: " << fixed << setprecision( 2 ) << gigabits_per_second
@@ -85,6 +98,9 @@ void speed_test( const size_t num_chunks,   // NOLINT(bugprone-easily-swappable-
 void program_body()
 {
   speed_test( 10000, 1500, 1370 );
+  speed_test( 1000, 15000, 1370, 10 );
+  speed_test( 10000, 1500, 1370, 0, Reassembler::Mode::Window );
+  speed_test( 1000, 15000, 1370, 10, Reassembler::Mode::Window );
 }
 
 int main()
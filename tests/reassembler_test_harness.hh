@@ -27,10 +27,13 @@ struct ReassemblerTestStep : public TestStep<Reassembler>
 class ReassemblerTestHarness : public TestHarness<Reassembler>
 {
 public:
-  ReassemblerTestHarness( std::string test_name, uint64_t capacity )
+  ReassemblerTestHarness( std::string test_name,
+                          uint64_t capacity,
+                          Reassembler::Mode mode = Reassembler::Mode::Extents )
     : TestHarness( move( test_name ),
-                   "capacity=" + std::to_string( capacity ),
-                   { Reassembler { ByteStream { capacity } } } )
+                   "capacity=" + std::to_string( capacity )
+                     + ( mode == Reassembler::Mode::Window ? ", mode=window" : "" ),
+                   { Reassembler { ByteStream { capacity }, mode } } )
   {}
 
   template<std::derived_from<TestStep<ByteStream>> T>
@@ -0,0 +1,135 @@
+#include "random.hh"
+#include "reassembler_test_harness.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+constexpr auto window = Reassembler::Mode::Window;
+
+// Feed the same random, overlapping, reordered segments to both modes (popping now and then, so that
+// the window wraps around) and check that they agree after every step.
+void compare_modes( uint64_t capacity )
+{
+  auto rd = get_random_engine();
+  Reassembler extents { ByteStream { capacity } };
+  Reassembler windowed { ByteStream { capacity }, window };
+
+  string data( capacity * 20, 0 );
+  generate( data.begin(), data.end(), [&] { return rd(); } );
+  string out_extents;
+  string out_windowed;
+
+  for ( int step = 0; step < 4000; step++ ) {
+    const uint64_t base = extents.writer().bytes_pushed();
+    const uint64_t first = min<uint64_t>( data.size() - 1, base + rd() % ( capacity + capacity / 4 ) );
+    const uint64_t len = min<uint64_t>( data.size() - first, 1 + rd() % ( capacity / 3 ) );
+    const bool last = first + len == data.size();
+    extents.insert( first, data.substr( first, len ), last );
+    windowed.insert( first, data.substr( first, len ), last );
+
+    if ( rd() % 3 == 0 ) {
+      string chunk;
+      read( extents.reader(), rd() % capacity, chunk );
+      out_extents += chunk;
+      read( windowed.reader(), chunk.size(), chunk );
+      out_windowed += chunk;
+    }
+
+    if ( extents.writer().bytes_pushed() != windowed.writer().bytes_pushed()
+         or extents.bytes_pending() != windowed.bytes_pending()
+         or extents.reader().is_finished() != windowed.reader().is_finished()
+         or extents.pending_ranges( SIZE_MAX ) != windowed.pending_ranges( SIZE_MAX )
+         or extents.pending_range( first ) != windowed.pending_range( first ) ) {
+      throw runtime_error( "window mode disagrees with extents mode at step " + to_string( step ) );
+    }
+  }
+
+  string rest;
+  read( extents.reader(), capacity, rest );
+  out_extents += rest;
+  read( windowed.reader(), capacity, rest );
+  out_windowed += rest;
+  if ( out_extents != out_windowed or out_windowed != data.substr( 0, out_windowed.size() ) ) {
+    throw runtime_error( "window mode produced different bytes" );
+  }
+}
+} // namespace
+
+int main()
+{
+  try {
+    {
+      ReassemblerTestHarness test { "window holes", 65000, window };
+
+      test.execute( Insert { "b", 1 } );
+      test.execute( Insert { "d", 3 } );
+      test.execute( BytesPending( 2 ) );
+      test.execute( Insert { "c", 2 } );
+      test.execute( BytesPushed( 0 ) );
+      test.execute( BytesPending( 3 ) );
+      test.execute( Insert { "a", 0 } );
+      test.execute( BytesPushed( 4 ) );
+      test.execute( BytesPending( 0 ) );
+      test.execute( ReadAll( "abcd" ) );
+      test.execute( IsFinished { false } );
+      test.execute( Insert { "", 4 }.is_last() );
+      test.execute( IsFinished { true } );
+    }
+
+    {
+      ReassemblerTestHarness test { "window overlap", 100, window };
+
+      test.execute( Insert { "cdef", 2 } );
+      test.execute( Insert { "defgh", 3 } );
+      test.execute( BytesPending( 6 ) );
+      test.execute( Insert { "abcd", 0 } );
+      test.execute( BytesPending( 0 ) );
+      test.execute( ReadAll( "abcdefgh" ) );
+      test.execute( Insert { "ghij", 6 }.is_last() );
+      test.execute( ReadAll( "ij" ) );
+      test.execute( IsFinished { true } );
+    }
+
+    {
+      ReassemblerTestHarness test { "window capacity and wrap-around", 8, window };
+
+      test.execute( Insert { "cdefghijk", 2 } );
+      test.execute( BytesPending( 6 ) );
+      test.execute( Insert { "ab", 0 } );
+      test.execute( BytesPushed( 8 ) );
+      test.execute( ReadAll( "abcdefgh" ) );
+      // the window's first bytes are reused for indexes 8 and on
+      test.execute( Insert { "mnop", 12 }.is_last() );
+      test.execute( Insert { "jkl", 9 } );
+      test.execute( BytesPending( 7 ) );
+      test.execute( Insert { "i", 8 } );
+      test.execute( ReadAll( "ijklmnop" ) );
+      test.execute( IsFinished { true } );
+    }
+
+    {
+      ReassemblerTestHarness test { "window drops what does not fit", 4, window };
+
+      test.execute( Insert { "bcdef", 1 }.is_last() );
+      test.execute( BytesPending( 3 ) );
+      test.execute( Insert { "a", 0 } );
+      test.execute( ReadAll( "abcd" ) );
+      test.execute( IsFinished { false } );
+    }
+
+    compare_modes( 64 );
+    compare_modes( 1000 );
+    compare_modes( 4096 );
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
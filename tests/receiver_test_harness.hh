@@ -8,6 +8,7 @@
 #include <optional>
 #include <sstream>
 #include <utility>
+#include <vector>
 
 template<std::derived_from<TestStep<Reassembler>> T>
 struct DirectReassemblerTest : public TestStep<TCPReceiver>
@@ -83,6 +84,45 @@ struct ExpectReset : public ExpectBool<TCPReceiver>
   bool value( TCPReceiver& rs ) const override { return rs.send().RST; }
 };
 
+struct ExpectSACK : public ExpectNumber<TCPReceiver, std::vector<std::pair<Wrap32, Wrap32>>>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "SACK blocks"; }
+  std::vector<std::pair<Wrap32, Wrap32>> value( TCPReceiver& rs ) const override { return rs.send().sack; }
+};
+
+struct ExpectWindowScale : public ExpectNumber<TCPReceiver, std::optional<uint8_t>>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "window scale offered"; }
+  std::optional<uint8_t> value( TCPReceiver& rs ) const override { return rs.window_scale(); }
+};
+
+struct EnableWindowScaling : public Action<TCPReceiver>
+{
+  std::string description() const override { return "enable window scaling"; }
+  void execute( TCPReceiver& rs ) const override { rs.enable_window_scaling(); }
+};
+
+struct ExpectTimestampEcho : public ExpectNumber<TCPReceiver, std::optional<uint32_t>>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "timestamp_echo"; }
+  std::optional<uint32_t> value( TCPReceiver& rs ) const override { return rs.send().timestamp_echo; }
+};
+
+struct EnableSACK : public Action<TCPReceiver>
+{
+  std::string description() const override { return "enable SACK"; }
+  void execute( TCPReceiver& rs ) const override { rs.enable_sack(); }
+};
+
+struct EnableTimestamps : public Action<TCPReceiver>
+{
+  std::string description() const override { return "enable timestamps"; }
+  void execute( TCPReceiver& rs ) const override { rs.enable_timestamps(); }
+};
+
 struct ExpectAcknoBetween : public Expectation<TCPReceiver>
 {
   Wrap32 isn_;
@@ -141,6 +181,24 @@ struct SegmentArrives : public Action<TCPReceiver>
     return *this;
   }
 
+  SegmentArrives& with_sack_permitted()
+  {
+    msg_.SACK_permitted = true;
+    return *this;
+  }
+
+  SegmentArrives& with_window_scale( uint8_t shift )
+  {
+    msg_.window_scale = shift;
+    return *this;
+  }
+
+  SegmentArrives& with_timestamp( uint32_t timestamp )
+  {
+    msg_.timestamp = timestamp;
+    return *this;
+  }
+
   SegmentArrives& with_seqno( Wrap32 seqno_ )
   {
     msg_.seqno = seqno_;
@@ -175,6 +233,15 @@ struct SegmentArrives : public Action<TCPReceiver>
     if ( msg_.SYN ) {
       ss << " +SYN";
     }
+    if ( msg_.SACK_permitted ) {
+      ss << " +SACK-permitted";
+    }
+    if ( msg_.window_scale.has_value() ) {
+      ss << " window-scale=" << static_cast<int>( msg_.window_scale.value() );
+    }
+    if ( msg_.timestamp.has_value() ) {
+      ss << " tsval=" << msg_.timestamp.value();
+    }
     if ( not msg_.payload.empty() ) {
       ss << " payload=\"" << Printer::prettify( msg_.payload ) << "\"";
     }
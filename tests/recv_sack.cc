@@ -0,0 +1,137 @@
+#include "checksum.hh"
+#include "parser.hh"
+#include "random.hh"
+#include "receiver_test_harness.hh"
+#include "tcp_segment.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      const uint32_t isn = uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd );
+      TCPReceiverTestHarness test { "no SACK blocks unless the SYN permitted them", 2358 };
+      test.execute( EnableSACK {} );
+      test.execute( SegmentArrives {}.with_syn().with_seqno( isn ) );
+      test.execute( SegmentArrives {}.with_seqno( isn + 5 ).with_data( "efgh" ) );
+      test.execute( ExpectAckno { Wrap32 { isn + 1 } } );
+      test.execute( BytesPending { 4 } );
+      test.execute( ExpectSACK { {} } );
+    }
+
+    {
+      const uint32_t isn = uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd );
+      TCPReceiverTestHarness test { "no SACK blocks unless SACK is enabled", 2358 };
+      test.execute( SegmentArrives {}.with_syn().with_sack_permitted().with_seqno( isn ) );
+      test.execute( SegmentArrives {}.with_seqno( isn + 5 ).with_data( "efgh" ) );
+      test.execute( BytesPending { 4 } );
+      test.execute( ExpectSACK { {} } );
+    }
+
+    {
+      const uint32_t isn = uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd );
+      const Wrap32 zero { isn };
+      TCPReceiverTestHarness test { "SACK blocks, most recent first", 2358 };
+      test.execute( EnableSACK {} );
+      test.execute( SegmentArrives {}.with_syn().with_sack_permitted().with_seqno( isn ) );
+      test.execute( ExpectSACK { {} } );
+      test.execute( SegmentArrives {}.with_seqno( isn + 5 ).with_data( "efgh" ) );
+      test.execute( ExpectSACK { { { zero + 5, zero + 9 } } } );
+      test.execute( SegmentArrives {}.with_seqno( isn + 13 ).with_data( "mn" ) );
+      test.execute( ExpectSACK { { { zero + 13, zero + 15 }, { zero + 5, zero + 9 } } } );
+      // extends the first block
+      test.execute( SegmentArrives {}.with_seqno( isn + 9 ).with_data( "ij" ) );
+      test.execute( ExpectSACK { { { zero + 5, zero + 11 }, { zero + 13, zero + 15 } } } );
+      test.execute( SegmentArrives {}.with_seqno( isn + 1 ).with_data( "abcd" ) );
+      test.execute( ExpectAckno { Wrap32 { isn + 11 } } );
+      test.execute( ExpectSACK { { { zero + 13, zero + 15 } } } );
+      test.execute( SegmentArrives {}.with_seqno( isn + 11 ).with_data( "kl" ) );
+      test.execute( ExpectAckno { Wrap32 { isn + 15 } } );
+      test.execute( ExpectSACK { {} } );
+    }
+
+    {
+      const uint32_t isn = uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd );
+      const Wrap32 zero { isn };
+      TCPReceiverTestHarness test { "at most four SACK blocks", 2358 };
+      test.execute( EnableSACK {} );
+      test.execute( SegmentArrives {}.with_syn().with_sack_permitted().with_seqno( isn ) );
+      for ( uint32_t i = 1; i <= 6; i++ ) {
+        test.execute( SegmentArrives {}.with_seqno( isn + 1 + 10 * i ).with_data( "x" ) );
+      }
+      test.execute( SegmentArrives {}.with_seqno( isn + 41 ).with_data( "yz" ) );
+      test.execute( ExpectSACK { { { zero + 41, zero + 43 },
+                                   { zero + 11, zero + 12 },
+                                   { zero + 21, zero + 22 },
+                                   { zero + 31, zero + 32 } } } );
+    }
+
+    {
+      TCPMessage msg;
+      msg.sender.seqno = Wrap32 { static_cast<uint32_t>( rd() ) };
+      msg.sender.SYN = true;
+      msg.sender.SACK_permitted = true;
+      msg.sender.payload = "hello";
+      msg.receiver.ackno = Wrap32 { static_cast<uint32_t>( rd() ) };
+      msg.receiver.window_size = 1234;
+      for ( uint32_t i = 0; i < 5; i++ ) {
+        const auto left = static_cast<uint32_t>( rd() );
+        msg.receiver.sack.emplace_back( Wrap32 { left }, Wrap32 { left + 100 } );
+      }
+
+      TCPSegment seg { msg, {} };
+      seg.compute_checksum( 0 );
+      TCPSegment parsed;
+      if ( not parse( parsed, serialize( seg ), 0 ) ) {
+        throw runtime_error( "TCP segment with options failed to parse" );
+      }
+      const auto& [sender, receiver] = parsed.message;
+      if ( not sender.SACK_permitted or sender.payload != "hello" or receiver.ackno != msg.receiver.ackno
+           or receiver.window_size != 1234 ) {
+        throw runtime_error( "TCP segment fields did not survive serialization" );
+      }
+      msg.receiver.sack.erase( msg.receiver.sack.begin() + TCPReceiverMessage::MAX_SACK_BLOCKS,
+                               msg.receiver.sack.end() );
+      if ( receiver.sack != msg.receiver.sack ) {
+        throw runtime_error( "SACK blocks did not survive serialization (or more than fit were sent)" );
+      }
+
+      // options the segment doesn't understand are skipped
+      msg.sender.SYN = false;
+      msg.receiver.sack.clear();
+      TCPSegment plain { msg, {} };
+      auto buffers = serialize( plain );
+      string& header = buffers.front();
+      header[12] = static_cast<char>( 9 << 4 ); // data offset: four more words
+      header += string { "\x01\x01\xfd\x0a"
+                         "abcdefgh"
+                         "\x00\x00\x00\x00",
+                         16 }; // NOPs, an experimental option (RFC 4727), end, padding
+      header[16] = header[17] = 0;
+      InternetChecksum check;
+      check.add( buffers );
+      header[16] = static_cast<char>( check.value() >> 8 );
+      header[17] = static_cast<char>( check.value() & 0xff );
+      TCPSegment other;
+      if ( not parse( other, buffers, 0 ) or other.message.sender.payload != "hello"
+           or other.message.sender.SACK_permitted ) {
+        throw runtime_error( "unknown TCP options were not skipped" );
+      }
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
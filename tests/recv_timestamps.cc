@@ -0,0 +1,135 @@
+#include "parser.hh"
+#include "random.hh"
+#include "receiver_test_harness.hh"
+#include "tcp_segment.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      const uint32_t isn = uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd );
+      TCPReceiverTestHarness test { "no echo unless both sides use timestamps", 4000 };
+      test.execute( SegmentArrives {}.with_syn().with_timestamp( 100 ).with_seqno( isn ) );
+      test.execute( ExpectTimestampEcho { {} } );
+
+      TCPReceiverTestHarness other { "no echo unless the peer's SYN carries a timestamp", 4000 };
+      other.execute( EnableTimestamps {} );
+      other.execute( SegmentArrives {}.with_syn().with_seqno( isn ) );
+      other.execute( SegmentArrives {}.with_seqno( isn + 1 ).with_data( "abcd" ).with_timestamp( 100 ) );
+      other.execute( ExpectTimestampEcho { {} } );
+    }
+
+    {
+      const uint32_t isn = uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd );
+      TCPReceiverTestHarness test { "the echo follows the segment that advanced the ackno", 4000 };
+      test.execute( EnableTimestamps {} );
+      test.execute( SegmentArrives {}.with_syn().with_timestamp( 100 ).with_seqno( isn ) );
+      test.execute( ExpectTimestampEcho { 100 } );
+      test.execute( SegmentArrives {}.with_seqno( isn + 1 ).with_data( "abcd" ).with_timestamp( 110 ) );
+      test.execute( ExpectTimestampEcho { 110 } );
+      // out of order: the ACKs it causes still echo the last in-order segment
+      test.execute( SegmentArrives {}.with_seqno( isn + 9 ).with_data( "ijkl" ).with_timestamp( 120 ) );
+      test.execute( ExpectTimestampEcho { 110 } );
+      test.execute( SegmentArrives {}.with_seqno( isn + 5 ).with_data( "efgh" ).with_timestamp( 130 ) );
+      test.execute( ExpectAckno { Wrap32 { isn + 13 } } );
+      test.execute( ExpectTimestampEcho { 130 } );
+    }
+
+    {
+      const uint32_t isn = uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd );
+      TCPReceiverTestHarness test { "PAWS drops old duplicates", 4000 };
+      test.execute( EnableTimestamps {} );
+      test.execute( SegmentArrives {}.with_syn().with_timestamp( 1000 ).with_seqno( isn ) );
+      test.execute( SegmentArrives {}.with_seqno( isn + 1 ).with_data( "abcd" ).with_timestamp( 1010 ) );
+      // At high throughput sequence numbers wrap within seconds, so a segment held up in the network
+      // from 2^32 bytes ago can carry the seqno of data not received yet; only its timestamp is older.
+      test.execute( SegmentArrives {}.with_seqno( isn + 5 ).with_data( "XXXX" ).with_timestamp( 1005 ) );
+      test.execute( ExpectAckno { Wrap32 { isn + 5 } } );
+      test.execute( BytesPending { 0 } );
+      test.execute( ExpectTimestampEcho { 1010 } );
+      test.execute( SegmentArrives {}.with_seqno( isn + 5 ).with_data( "efgh" ).with_timestamp( 1020 ) );
+      test.execute( ReadAll { "abcdefgh" } );
+    }
+
+    {
+      const uint32_t isn = uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd );
+      TCPReceiverTestHarness test { "timestamps compare modulo 2^32", 4000 };
+      test.execute( EnableTimestamps {} );
+      test.execute( SegmentArrives {}.with_syn().with_timestamp( UINT32_MAX - 5 ).with_seqno( isn ) );
+      test.execute( SegmentArrives {}.with_seqno( isn + 1 ).with_data( "abcd" ).with_timestamp( 5 ) );
+      test.execute( ExpectTimestampEcho { 5 } );
+      test.execute( SegmentArrives {}.with_seqno( isn + 5 ).with_data( "XXXX" ).with_timestamp( UINT32_MAX ) );
+      test.execute( ReadAll { "abcd" } );
+    }
+
+    {
+      // receive_batch applies the same checks
+      const Wrap32 isn { static_cast<uint32_t>( rd() ) };
+      TCPReceiver receiver { Reassembler { ByteStream { 4000 } } };
+      receiver.enable_timestamps();
+      vector<TCPSenderMessage> batch;
+      batch.push_back( { .seqno = isn, .SYN = true, .timestamp = 50 } );
+      batch.push_back( { .seqno = isn + 1, .payload = "abcd", .timestamp = 60 } );
+      batch.push_back( { .seqno = isn + 5, .payload = "XXXX", .timestamp = 55 } );
+      receiver.receive_batch( batch );
+      if ( receiver.send().ackno != isn + 5 or receiver.send().timestamp_echo != 60U ) {
+        throw runtime_error( "receive_batch should drop the old duplicate and echo the last timestamp" );
+      }
+    }
+
+    {
+      TCPMessage msg;
+      msg.sender.seqno = Wrap32 { static_cast<uint32_t>( rd() ) };
+      msg.sender.SYN = true;
+      msg.sender.SACK_permitted = true;
+      msg.sender.window_scale = 7;
+      msg.sender.timestamp = 0x12345678;
+
+      // a SYN has room for every option, and its echo means nothing without ACK
+      TCPSegment seg { msg, {} };
+      seg.compute_checksum( 0 );
+      TCPSegment parsed;
+      if ( not parse( parsed, serialize( seg ), 0 ) or parsed.message.sender.timestamp != 0x12345678U
+           or parsed.message.receiver.timestamp_echo.has_value() or parsed.message.sender.window_scale != 7
+           or not parsed.message.sender.SACK_permitted ) {
+        throw runtime_error( "SYN options did not survive serialization" );
+      }
+
+      // next to timestamps there is only room for three SACK blocks
+      msg.sender.SYN = false;
+      msg.receiver.ackno = Wrap32 { static_cast<uint32_t>( rd() ) };
+      msg.receiver.timestamp_echo = 0x9abcdef0;
+      for ( uint32_t i = 0; i < 4; i++ ) {
+        const auto left = static_cast<uint32_t>( rd() );
+        msg.receiver.sack.emplace_back( Wrap32 { left }, Wrap32 { left + 100 } );
+      }
+      TCPSegment data { msg, {} };
+      data.compute_checksum( 0 );
+      TCPSegment parsed_data;
+      if ( not parse( parsed_data, serialize( data ), 0 ) or parsed_data.message.sender.timestamp != 0x12345678U
+           or parsed_data.message.receiver.timestamp_echo != 0x9abcdef0U ) {
+        throw runtime_error( "timestamps did not survive serialization" );
+      }
+      msg.receiver.sack.pop_back();
+      if ( parsed_data.message.receiver.sack != msg.receiver.sack ) {
+        throw runtime_error( "more SACK blocks were sent than fit next to timestamps" );
+      }
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,105 @@
+#include "parser.hh"
+#include "random.hh"
+#include "receiver_test_harness.hh"
+#include "tcp_segment.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      const uint32_t isn = uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd );
+      TCPReceiverTestHarness test { "window capped at 65535 without window scaling", 1'000'000 };
+      test.execute( ExpectWindowScale { {} } );
+      test.execute( SegmentArrives {}.with_syn().with_window_scale( 7 ).with_seqno( isn ) );
+      test.execute( ExpectWindow { UINT16_MAX } );
+    }
+
+    {
+      const uint32_t isn = uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd );
+      TCPReceiverTestHarness test { "no shift needed for a small capacity", 64000 };
+      test.execute( EnableWindowScaling {} );
+      test.execute( ExpectWindowScale { 0 } );
+      test.execute( SegmentArrives {}.with_syn().with_window_scale( 7 ).with_seqno( isn ) );
+      test.execute( ExpectWindow { 64000 } );
+    }
+
+    {
+      const uint32_t isn = uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd );
+      TCPReceiverTestHarness test { "window scaled once both sides offer it", 1'000'000 };
+      test.execute( EnableWindowScaling {} );
+      test.execute( ExpectWindowScale { 4 } );
+      test.execute( ExpectWindow { UINT16_MAX } );
+      test.execute( SegmentArrives {}.with_syn().with_window_scale( 2 ).with_seqno( isn ) );
+      test.execute( ExpectWindow { 62500 } );
+      // rounded down, so the window never claims more than there is room for
+      test.execute( SegmentArrives {}.with_seqno( isn + 1 ).with_data( "abcde" ) );
+      test.execute( ExpectWindow { 62499 } );
+      test.execute( ReadAll { "abcde" } );
+      test.execute( ExpectWindow { 62500 } );
+    }
+
+    {
+      const uint32_t isn = uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd );
+      TCPReceiverTestHarness test { "window not scaled unless the peer's SYN offers it", 1'000'000 };
+      test.execute( EnableWindowScaling {} );
+      test.execute( SegmentArrives {}.with_syn().with_seqno( isn ) );
+      test.execute( ExpectWindow { UINT16_MAX } );
+    }
+
+    {
+      const uint32_t isn = uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd );
+      TCPReceiverTestHarness test { "shift at most 14", uint64_t { 1 } << 40 };
+      test.execute( EnableWindowScaling {} );
+      test.execute( ExpectWindowScale { 14 } );
+      test.execute( SegmentArrives {}.with_syn().with_window_scale( 14 ).with_seqno( isn ) );
+      test.execute( ExpectWindow { UINT16_MAX } );
+    }
+
+    {
+      TCPMessage msg;
+      msg.sender.seqno = Wrap32 { static_cast<uint32_t>( rd() ) };
+      msg.sender.SYN = true;
+      msg.sender.SACK_permitted = true;
+      msg.sender.window_scale = 9;
+      msg.receiver.window_size = 4321;
+
+      TCPSegment seg { msg, {} };
+      seg.compute_checksum( 0 );
+      TCPSegment parsed;
+      if ( not parse( parsed, serialize( seg ), 0 ) or parsed.message.sender.window_scale != 9
+           or not parsed.message.sender.SACK_permitted or parsed.message.receiver.window_size != 4321 ) {
+        throw runtime_error( "window scale option did not survive serialization" );
+      }
+
+      // a shift above 14 is taken to be 14
+      seg.message.sender.window_scale = 20;
+      seg.compute_checksum( 0 );
+      if ( not parse( parsed, serialize( seg ), 0 ) or parsed.message.sender.window_scale != 14 ) {
+        throw runtime_error( "window scale above 14 was not limited" );
+      }
+
+      // only a SYN carries it
+      seg.message.sender.SYN = false;
+      seg.compute_checksum( 0 );
+      TCPSegment plain;
+      if ( not parse( plain, serialize( seg ), 0 ) or plain.message.sender.window_scale.has_value() ) {
+        throw runtime_error( "window scale option sent without SYN" );
+      }
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,239 @@
+#include "congestion_control.hh"
+#include "random.hh"
+#include "sender_test_harness.hh"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+using namespace std;
+
+namespace {
+constexpr uint64_t mss = 1000;
+
+void expect( bool condition, const string& what )
+{
+  if ( not condition ) {
+    throw runtime_error( "congestion control: " + what );
+  }
+}
+
+CongestionControl::Ack ack( uint64_t acked, uint64_t now_ms = 0, optional<uint64_t> rtt_ms = {} )
+{
+  return {
+    .acked = acked, .in_flight = 0, .delivered = 0, .now_ms = now_ms, .rtt_ms = rtt_ms, .delivery_rate = {} };
+}
+
+void reno()
+{
+  Reno cc { mss };
+  expect( cc.cwnd() == 10 * mss, "Reno starts with ten segments" );
+  for ( int i = 0; i < 5; i++ ) {
+    cc.on_ack( ack( mss ) );
+  }
+  expect( cc.cwnd() == 15 * mss, "slow start grows a segment per ACKed segment" );
+
+  cc.on_loss( 15 * mss, 0 );
+  expect( cc.cwnd() == 7500 and cc.ssthresh() == 7500, "a loss halves the window" );
+  for ( int i = 0; i < 7; i++ ) {
+    cc.on_ack( ack( mss ) );
+  }
+  expect( cc.cwnd() == 7500, "congestion avoidance waits for a window of ACKs" );
+  cc.on_ack( ack( 500 ) );
+  expect( cc.cwnd() == 8500, "then grows one segment" );
+
+  cc.on_rto( 8000, 0 );
+  expect( cc.cwnd() == mss and cc.ssthresh() == 4000, "a timeout goes back to one segment" );
+  for ( int i = 0; i < 4; i++ ) {
+    cc.on_ack( ack( mss ) );
+  }
+  expect( cc.cwnd() == 4 * mss, "slow start up to ssthresh, then congestion avoidance" );
+}
+
+void cubic()
+{
+  CUBIC cc { mss };
+  while ( cc.cwnd() < 100 * mss ) {
+    cc.on_ack( ack( mss ) );
+  }
+  const uint64_t w_max = cc.cwnd();
+  cc.on_loss( w_max, 0 );
+  expect( cc.cwnd() == static_cast<uint64_t>( CUBIC::beta * static_cast<double>( w_max ) ), "a loss keeps 70%" );
+  expect( cc.w_max() == w_max, "and remembers where it happened" );
+
+  // one ACK every 10 ms, the RTT
+  const double k_s = cbrt( static_cast<double>( w_max ) * ( 1 - CUBIC::beta ) / mss / CUBIC::C );
+  const auto k_ms = static_cast<uint64_t>( k_s * 1000 );
+  uint64_t at_half_k = 0;
+  uint64_t at_k = 0;
+  for ( uint64_t now = 0; now <= 2 * k_ms; now += 10 ) {
+    cc.on_ack( ack( mss, now, 10 ) );
+    if ( now <= k_ms / 2 ) {
+      at_half_k = cc.cwnd();
+    }
+    if ( now <= k_ms ) {
+      at_k = cc.cwnd();
+    }
+  }
+  expect( at_half_k < w_max and at_half_k > w_max * 8 / 10, "concave growth back towards W_max" );
+  expect( at_k > w_max * 97 / 100 and at_k < w_max * 102 / 100, "reaches W_max after K seconds" );
+  expect( cc.cwnd() > w_max * 105 / 100, "convex growth beyond it" );
+
+  // a loss below the last W_max leaves room for other flows
+  cc.on_loss( 0, 0 );
+  cc.on_ack( ack( mss, 3 * k_ms, 10 ) );
+  const uint64_t second = cc.w_max();
+  cc.on_loss( 0, 0 );
+  expect( second > cc.w_max(), "fast convergence lowers W_max" );
+  expect( static_cast<double>( cc.w_max() ) < static_cast<double>( cc.cwnd() ) / CUBIC::beta,
+          "below the window at the loss" );
+}
+
+void bbr()
+{
+  // a path delivering 1000 bytes per ms, with a 20 ms RTT: its BDP is 20000 bytes
+  BBR cc { mss };
+  expect( cc.pacing_rate() == 0 and cc.cwnd() == 10 * mss, "no model yet" );
+  uint64_t delivered = 0;
+  bool saw_probe = false;
+  bool saw_drain = false;
+  for ( uint64_t now = 1; now <= 2000; now++ ) {
+    // a Startup-sized queue until Drain
+    const uint64_t in_flight = cc.phase() == BBR::Phase::Startup ? 30 * mss : 20 * mss;
+    delivered += mss;
+    cc.on_ack( { .acked = mss,
+                 .in_flight = in_flight,
+                 .delivered = delivered,
+                 .now_ms = now,
+                 .rtt_ms = 20,
+                 .delivery_rate = 1'000'000 } );
+    saw_drain |= cc.phase() == BBR::Phase::Drain;
+    saw_probe |= cc.pacing_rate() == 1'250'000;
+  }
+  expect( cc.bottleneck_bandwidth() == 1'000'000 and cc.min_rtt_ms() == 20, "measures the path" );
+  expect( saw_drain and cc.phase() == BBR::Phase::ProbeBW, "leaves Startup when the bandwidth stops growing" );
+  expect( cc.cwnd() == 40 * mss, "keeps twice the BDP in flight" );
+  expect( saw_probe, "probes for more bandwidth" );
+
+  cc.on_rto( 0, 2000 );
+  expect( cc.cwnd() == mss, "one segment after a timeout" );
+  cc.on_ack( { .acked = mss,
+              .in_flight = 0,
+              .delivered = delivered + mss,
+              .now_ms = 2001,
+              .rtt_ms = {},
+              .delivery_rate = {} } );
+  expect( cc.cwnd() == 40 * mss, "then back to the model" );
+}
+
+// Sends at a fixed rate with no window limit.
+class FixedRate : public CongestionControl
+{
+public:
+  FixedRate() : CongestionControl( mss ) {}
+  string_view name() const override { return "fixed rate"; }
+  uint64_t cwnd() const override { return UINT64_MAX; }
+  uint64_t pacing_rate() const override { return 100'000; }
+  void on_ack( const Ack& /* ack */ ) override {}
+  void on_loss( uint64_t /* in_flight */, uint64_t /* now_ms */ ) override {}
+  void on_rto( uint64_t /* in_flight */, uint64_t /* now_ms */ ) override {}
+};
+} // namespace
+
+int main()
+{
+  try {
+    reno();
+    cubic();
+    bbr();
+
+    auto rd = get_random_engine();
+    const string data( 20 * mss, 'x' );
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+
+      TCPSenderTestHarness test { "In flight is limited by the congestion window", cfg };
+      test.execute( SetCongestionControl { CongestionControl::Algorithm::Reno } );
+      test.execute( ExpectCwnd { 10 * mss } );
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_seqno( isn ) );
+      test.execute( AckReceived { isn + 1 }.with_win( 60000 ) );
+      test.execute( ExpectCwnd { 10 * mss + 1 } );
+      test.execute( Push( data ) );
+      for ( uint64_t i = 0; i < 10; i++ ) {
+        test.execute( ExpectMessage {}.with_payload_size( mss ).with_seqno( isn + 1 + i * mss ) );
+      }
+      test.execute( ExpectMessage {}.with_payload_size( 1 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( ExpectSeqnosInFlight { 10 * mss + 1 } );
+
+      // slow start: the ACK frees a segment's worth and grows the window by another
+      test.execute( AckReceived { isn + 1 + mss }.with_win( 60000 ) );
+      test.execute( ExpectCwnd { 11 * mss + 1 } );
+      test.execute( ExpectMessage {}.with_payload_size( mss ) );
+      test.execute( ExpectMessage {}.with_payload_size( mss ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( ExpectSeqnosInFlight { 11 * mss + 1 } );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+
+      TCPSenderTestHarness test { "The receiver's window still applies", cfg };
+      test.execute( SetCongestionControl { CongestionControl::Algorithm::CUBIC } );
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ) );
+      test.execute( AckReceived { isn + 1 }.with_win( 2500 ) );
+      test.execute( Push( data ) );
+      test.execute( ExpectMessage {}.with_payload_size( mss ) );
+      test.execute( ExpectMessage {}.with_payload_size( mss ) );
+      test.execute( ExpectMessage {}.with_payload_size( 500 ) );
+      test.execute( ExpectNoSegment {} );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+
+      TCPSenderTestHarness test { "Segments go out at the pacing rate", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ) );
+      test.execute( AckReceived { isn + 1 }.with_win( 60000 ) );
+      test.execute( SetCongestionControl { "fixed rate", [] { return make_unique<FixedRate>(); } } );
+      test.execute( Push( data ) );
+      test.execute( ExpectNoSegment {} );
+      // 100 bytes per ms: a segment may go out once some credit has built up, and then the credit
+      // is overdrawn until the rest of it has been earned
+      test.execute( Tick { 9 } );
+      test.execute( ExpectMessage {}.with_payload_size( mss ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( Tick { 1 } );
+      test.execute( ExpectNoSegment {} );
+      test.execute( Tick { 1 } );
+      test.execute( ExpectMessage {}.with_payload_size( mss ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( Tick { 25 } );
+      test.execute( ExpectMessage {}.with_payload_size( mss ) );
+      test.execute( ExpectMessage {}.with_payload_size( mss ) );
+      test.execute( ExpectNoSegment {} );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,105 @@
+#include "random.hh"
+#include "sender_test_harness.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+    const string a( 1000, 'a' );
+    const string b( 1000, 'b' );
+    const string c( 1000, 'c' );
+    const string d( 1000, 'd' );
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+
+      TCPSenderTestHarness test { "Third duplicate ACK retransmits, partial ACK retransmits the next hole", cfg };
+      test.execute( EnableFastRetransmit {} );
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_seqno( isn ) );
+      test.execute( AckReceived { isn + 1 }.with_win( 4000 ) );
+      test.execute( Push( a + b + c + d ) );
+      test.execute( ExpectMessage {}.with_data( a ).with_seqno( isn + 1 ) );
+      test.execute( ExpectMessage {}.with_data( b ).with_seqno( isn + 1001 ) );
+      test.execute( ExpectMessage {}.with_data( c ).with_seqno( isn + 2001 ) );
+      test.execute( ExpectMessage {}.with_data( d ).with_seqno( isn + 3001 ) );
+      test.execute( ExpectNoSegment {} );
+
+      // "b" and "d" are lost
+      test.execute( AckReceived { isn + 1001 }.with_win( 4000 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( AckReceived { isn + 1001 }.with_win( 4000 ) );
+      test.execute( AckReceived { isn + 1001 }.with_win( 4000 ).with_carried_data() );
+      test.execute( AckReceived { isn + 1001 }.with_win( 3000 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( AckReceived { isn + 1001 }.with_win( 3000 ) );
+      test.execute( AckReceived { isn + 1001 }.with_win( 3000 ) );
+      test.execute( ExpectMessage {}.with_data( b ).with_seqno( isn + 1001 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( AckReceived { isn + 1001 }.with_win( 3000 ) );
+      test.execute( ExpectNoSegment {} );
+
+      test.execute( AckReceived { isn + 3001 }.with_win( 3000 ) );
+      test.execute( ExpectMessage {}.with_data( d ).with_seqno( isn + 3001 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( AckReceived { isn + 4001 }.with_win( 3000 ) );
+      test.execute( ExpectSeqnosInFlight { 0 } );
+      test.execute( ExpectFastRetransmissions { 2 } );
+      test.execute( ExpectConsecutiveRetransmissions { 0 } );
+      test.execute( ExpectNoSegment {} );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      const uint16_t rto = uniform_int_distribution<uint16_t> { 30, 10000 }( rd );
+      cfg.isn = isn;
+      cfg.rt_timeout = rto;
+
+      TCPSenderTestHarness test { "Duplicate ACKs for data sent before a timeout don't retransmit again", cfg };
+      test.execute( EnableFastRetransmit {} );
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_seqno( isn ) );
+      test.execute( AckReceived { isn + 1 }.with_win( 4000 ) );
+      test.execute( Push( a + b + c ) );
+      test.execute( ExpectMessage {}.with_data( a ) );
+      test.execute( ExpectMessage {}.with_data( b ) );
+      test.execute( ExpectMessage {}.with_data( c ) );
+      test.execute( Tick { rto } );
+      test.execute( ExpectMessage {}.with_data( a ).with_seqno( isn + 1 ) );
+      test.execute( AckReceived { isn + 1001 }.with_win( 4000 ) );
+      test.execute( AckReceived { isn + 1001 }.with_win( 4000 ) );
+      test.execute( AckReceived { isn + 1001 }.with_win( 4000 ) );
+      test.execute( AckReceived { isn + 1001 }.with_win( 4000 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( ExpectFastRetransmissions { 0 } );
+
+      // once everything sent before the timeout is acknowledged, a new loss is repaired quickly again
+      test.execute( AckReceived { isn + 3001 }.with_win( 4000 ) );
+      test.execute( Push( d + a ) );
+      test.execute( ExpectMessage {}.with_data( d ) );
+      test.execute( ExpectMessage {}.with_data( a ) );
+      for ( int i = 0; i < 3; i++ ) {
+        test.execute( AckReceived { isn + 3001 }.with_win( 4000 ) );
+      }
+      test.execute( ExpectMessage {}.with_data( d ).with_seqno( isn + 3001 ) );
+      test.execute( ExpectFastRetransmissions { 1 } );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,233 @@
+#include "parser.hh"
+#include "random.hh"
+#include "sender_test_harness.hh"
+#include "tcp_peer.hh"
+#include "tcp_segment.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+// Connect two peers, then send `bytes` from the client; returns the server's first data segment.
+TCPMessage first_data_segment( const TCPConfig& client_cfg, const TCPConfig& server_cfg, size_t bytes )
+{
+  TCPPeer client { client_cfg };
+  TCPPeer server { server_cfg };
+  vector<TCPMessage> to_server;
+  vector<TCPMessage> to_client;
+  const auto client_transmit = [&]( TCPMessage msg ) { to_server.push_back( move( msg ) ); };
+  const auto server_transmit = [&]( TCPMessage msg ) { to_client.push_back( move( msg ) ); };
+
+  client.push( client_transmit );
+  server.receive( move( to_server.at( 0 ) ), server_transmit );
+  to_server.clear();
+  client.receive( move( to_client.at( 0 ) ), client_transmit );
+  to_server.clear();
+
+  client.outbound_writer().push( string( bytes, 'x' ) );
+  client.push( client_transmit );
+  return to_server.at( 0 );
+}
+
+// Bytes of TCP header options and payload on a segment
+size_t options_and_payload( const TCPMessage& msg )
+{
+  size_t length = 0;
+  for ( const auto& buffer : serialize( TCPSegment { msg, {} } ) ) {
+    length += buffer.size();
+  }
+  return length - 20;
+}
+} // namespace
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+
+      TCPSenderTestHarness test { "Segments fill the MSS", cfg };
+      test.execute( SetMSS { 1460 } );
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ) );
+      test.execute( AckReceived { isn + 1 }.with_win( 4000 ) );
+      test.execute( Push( string( 3000, 'x' ) ) );
+      test.execute( ExpectMessage {}.with_payload_size( 1460 ) );
+      test.execute( ExpectMessage {}.with_payload_size( 1460 ) );
+      test.execute( ExpectMessage {}.with_payload_size( 80 ) );
+      test.execute( ExpectNoSegment {} );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+
+      TCPSenderTestHarness test { "The timestamp option comes out of the MSS", cfg };
+      test.execute( SetMSS { 1460 } );
+      test.execute( EnableTimestamps {} );
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ) );
+      test.execute( AckReceived { isn + 1 }.with_win( 4000 ) );
+      test.execute( Push( string( 3000, 'x' ) ) );
+      test.execute( ExpectMessage {}.with_payload_size( 1448 ) );
+      test.execute( ExpectMessage {}.with_payload_size( 1448 ) );
+      test.execute( ExpectMessage {}.with_payload_size( 104 ) );
+      test.execute( ExpectNoSegment {} );
+    }
+
+    {
+      if ( TCPConfig::mss_for_mtu( 1500 ) != 1460 or TCPConfig::mss_for_mtu( 9000 ) != 8960 ) {
+        throw runtime_error( "the MSS should be the MTU less 40 bytes of headers" );
+      }
+
+      // two peers on a 9000-byte MTU
+      TCPConfig jumbo;
+      jumbo.mss = TCPConfig::mss_for_mtu( 9000 );
+      jumbo.send_capacity = 100'000;
+      jumbo.timestamps = false;
+      if ( first_data_segment( jumbo, jumbo, 20'000 ).sender.payload.size() != 8960 ) {
+        throw runtime_error( "a 9000-byte MTU should carry 8960-byte segments" );
+      }
+      jumbo.timestamps = true;
+      if ( first_data_segment( jumbo, jumbo, 20'000 ).sender.payload.size() != 8948 ) {
+        throw runtime_error( "with timestamps, a 9000-byte MTU should carry 8948 bytes of payload" );
+      }
+
+      // each side's SYN limits what the other sends
+      TCPConfig ethernet = jumbo;
+      ethernet.mss = TCPConfig::mss_for_mtu( 1500 );
+      ethernet.timestamps = false;
+      if ( first_data_segment( jumbo, ethernet, 20'000 ).sender.payload.size() != 1460
+           or first_data_segment( ethernet, jumbo, 20'000 ).sender.payload.size() != 1460 ) {
+        throw runtime_error( "segments should be no larger than the smaller MSS" );
+      }
+    }
+
+    {
+      // a peer whose SYN has no MSS option gets 536-byte segments
+      TCPConfig cfg;
+      cfg.mss = 8960;
+      TCPPeer server { cfg };
+      vector<TCPMessage> to_client;
+      const auto server_transmit = [&]( TCPMessage msg ) { to_client.push_back( move( msg ) ); };
+
+      const Wrap32 isn( rd() );
+      TCPMessage syn;
+      syn.sender.seqno = isn;
+      syn.sender.SYN = true;
+      syn.receiver.window_size = 60000;
+      server.receive( move( syn ), server_transmit );
+      if ( to_client.size() != 1 or to_client[0].sender.mss != 8960U ) {
+        throw runtime_error( "the SYN-ACK should offer our MSS" );
+      }
+
+      TCPMessage ack;
+      ack.sender.seqno = isn + 1;
+      ack.receiver.ackno = to_client[0].sender.seqno + 1;
+      ack.receiver.window_size = 60000;
+      server.receive( move( ack ), server_transmit );
+      to_client.clear();
+      server.outbound_writer().push( string( 2000, 'x' ) );
+      server.push( server_transmit );
+      if ( to_client.empty() or to_client[0].sender.payload.size() != TCPConfig::DEFAULT_MSS ) {
+        throw runtime_error( "without an MSS option, segments should be 536 bytes" );
+      }
+    }
+
+    {
+      // SACK blocks come out of the MSS too, on new segments and on retransmissions
+      TCPConfig cfg;
+      cfg.mss = TCPConfig::mss_for_mtu( 1500 );
+      cfg.sack = true;
+      cfg.timestamps = true;
+      TCPPeer client { cfg };
+      TCPPeer server { cfg };
+      vector<TCPMessage> to_server;
+      vector<TCPMessage> to_client;
+      const auto client_transmit = [&]( TCPMessage msg ) { to_server.push_back( move( msg ) ); };
+      const auto server_transmit = [&]( TCPMessage msg ) { to_client.push_back( move( msg ) ); };
+
+      client.push( client_transmit );
+      server.receive( move( to_server.at( 0 ) ), server_transmit );
+      to_server.clear();
+      client.receive( move( to_client.at( 0 ) ), client_transmit );
+      to_client.clear();
+      for ( auto& msg : to_server ) {
+        server.receive( move( msg ), server_transmit );
+      }
+      to_server.clear();
+
+      // the server gets the client's second and (later) fourth segments, but not the first
+      client.outbound_writer().push( string( 5 * 1448, 'x' ) );
+      client.push( client_transmit );
+      vector<TCPMessage> client_segments = move( to_server );
+      server.receive( move( client_segments.at( 1 ) ), server_transmit );
+      to_client.clear();
+
+      server.outbound_writer().push( string( 5000, 'y' ) );
+      server.push( server_transmit );
+      if ( to_client.empty() or to_client[0].receiver.sack.size() != 1
+           or to_client[0].sender.payload.size() != 1460 - 12 - 12 ) {
+        throw runtime_error( "a data segment should leave room for one SACK block" );
+      }
+      for ( const auto& msg : to_client ) {
+        if ( options_and_payload( msg ) > cfg.mss ) {
+          throw runtime_error( "options and payload should fit in the MSS" );
+        }
+      }
+      to_client.clear();
+
+      server.receive( move( client_segments.at( 3 ) ), server_transmit );
+      to_client.clear();
+      server.tick( cfg.rt_timeout, server_transmit );
+      if ( to_client.size() != 1 or to_client[0].sender.payload.size() != 1460 - 12 - 12
+           or to_client[0].receiver.sack.size() != 1 or options_and_payload( to_client[0] ) > cfg.mss ) {
+        throw runtime_error( "a retransmission should leave off the SACK blocks that don't fit" );
+      }
+    }
+
+    {
+      TCPMessage msg;
+      msg.sender.seqno = Wrap32 { static_cast<uint32_t>( rd() ) };
+      msg.sender.SYN = true;
+      msg.sender.mss = 8960;
+      msg.sender.window_scale = 7;
+      msg.sender.SACK_permitted = true;
+      msg.sender.timestamp = 1;
+
+      TCPSegment seg { msg, {} };
+      seg.compute_checksum( 0 );
+      TCPSegment parsed;
+      if ( not parse( parsed, serialize( seg ), 0 ) or parsed.message.sender.mss != 8960U
+           or parsed.message.sender.window_scale != 7 or not parsed.message.sender.SACK_permitted
+           or parsed.message.sender.timestamp != 1U ) {
+        throw runtime_error( "MSS option did not survive serialization" );
+      }
+
+      // only a SYN carries it
+      seg.message.sender.SYN = false;
+      seg.compute_checksum( 0 );
+      TCPSegment plain;
+      if ( not parse( plain, serialize( seg ), 0 ) or plain.message.sender.mss.has_value() ) {
+        throw runtime_error( "MSS option sent without SYN" );
+      }
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
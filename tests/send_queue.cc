@@ -0,0 +1,107 @@
+#include "retransmission_queue.hh"
+#include "tcp_receiver_message.hh"
+#include "tcp_sender.hh"
+
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+void expect( bool condition, const string& what )
+{
+  if ( not condition ) {
+    throw runtime_error( "RetransmissionQueue: " + what );
+  }
+}
+
+RetransmissionQueue::Segment segment( uint64_t seqno, uint64_t len )
+{
+  return { seqno, seqno + len, 0, seqno == 0, false };
+}
+
+void ring()
+{
+  RetransmissionQueue queue;
+  expect( queue.empty() and queue.acknowledged( 100 ) == 0, "starts empty" );
+
+  // keep the queue partly full while the front moves, so the ring wraps and grows several times
+  uint64_t next = 0;
+  uint64_t acked = 0;
+  for ( int round = 0; round < 200; round++ ) {
+    for ( int i = 0; i < 3; i++ ) {
+      const uint64_t len = 1 + ( next % 7 );
+      queue.push_back( segment( next, len ) );
+      next += len;
+    }
+
+    // an ACK short of a segment's end only covers the ones before it
+    const size_t n = queue.acknowledged( queue[1].end - 1 );
+    expect( n == 1, "ack short of the second segment's end covers only the first" );
+    expect( queue.acknowledged( queue[1].end ) == 2, "ack at a segment's end covers it" );
+    expect( queue.acknowledged( acked ) == 0, "old ack covers nothing" );
+    queue.pop_front( n );
+    acked = queue.front().seqno;
+
+    for ( size_t i = 0; i < queue.size(); i++ ) {
+      expect( queue[i].seqno == ( i == 0 ? acked : queue[i - 1].end ), "segments stay in order" );
+      expect( queue[i].payload_size() == queue[i].end - queue[i].seqno - queue[i].SYN, "descriptors move intact" );
+    }
+  }
+  expect( queue.size() == 400 and queue.back().end == next, "every unacknowledged segment is kept" );
+
+  queue.pop_front( queue.acknowledged( next ) );
+  expect( queue.empty(), "a full ack empties the queue" );
+}
+
+// Sent bytes stay in the sender's stream (using its capacity) until acknowledged; a retransmission
+// is rebuilt from them.
+void sender_retains()
+{
+  const Wrap32 isn { 1000 };
+  TCPSender sender { ByteStream { 5000 }, isn, 100 };
+  vector<TCPSenderMessage> sent;
+  const auto transmit = [&]( const TCPSenderMessage& msg ) { sent.push_back( msg ); };
+
+  sender.push( transmit );
+  sender.receive( { isn + 1, 10000, false } );
+  string data;
+  for ( int i = 0; i < 3000; i++ ) {
+    data += static_cast<char>( 'a' + i % 26 );
+  }
+  sender.writer().push( data );
+  sender.push( transmit );
+  expect( sent.size() == 4 and sender.sequence_numbers_in_flight() == 3000, "three segments sent" );
+  expect( sender.writer().available_capacity() == 2000, "unacknowledged bytes are kept in the stream" );
+
+  sender.receive( { isn + 1 + 1000, 10000, false } );
+  expect( sender.writer().available_capacity() == 3000, "acknowledged bytes are released" );
+
+  sender.tick( 100, transmit );
+  expect( sent.size() == 5, "timeout retransmits" );
+  expect( sent.back().seqno == sent[2].seqno and sent.back().payload == sent[2].payload,
+          "retransmission is rebuilt from the stream" );
+  expect( sent.back().payload == data.substr( 1000, 1000 ), "with the right bytes" );
+
+  sender.receive( { isn + 1 + 3000, 10000, false } );
+  expect( sender.writer().available_capacity() == 5000 and sender.sequence_numbers_in_flight() == 0,
+          "everything released" );
+}
+} // namespace
+
+int main()
+{
+  try {
+    ring();
+    sender_retains();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
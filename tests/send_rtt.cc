@@ -0,0 +1,105 @@
+#include "random.hh"
+#include "sender_test_harness.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.rt_timeout = 1000;
+
+      TCPSenderTestHarness test { "RTO follows the measured RTT, and Karn's algorithm skips retransmissions", cfg };
+      test.execute( EnableRTTEstimation { 10, 60000 } );
+      test.execute( ExpectRTO { 1000 } );
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_no_flags().with_syn( true ).with_payload_size( 0 ).with_seqno( isn ) );
+      test.execute( Tick { 40 } );
+      test.execute( AckReceived { Wrap32 { isn + 1 } }.with_win( 1000 ) );
+      // first sample: SRTT = 40, RTTVAR = 20, RTO = SRTT + 4 * RTTVAR
+      test.execute( ExpectSRTT { 40 } );
+      test.execute( ExpectRTO { 120 } );
+
+      test.execute( Push( "abc" ) );
+      test.execute( ExpectMessage {}.with_data( "abc" ).with_seqno( isn + 1 ) );
+      test.execute( Tick { 119 } );
+      test.execute( ExpectNoSegment {} );
+      test.execute( Tick { 1 } );
+      test.execute( ExpectMessage {}.with_data( "abc" ).with_seqno( isn + 1 ) );
+      test.execute( ExpectRTO { 240 } );
+      test.execute( Tick { 5 } );
+      test.execute( AckReceived { Wrap32 { isn + 4 } }.with_win( 1000 ) );
+      // the ACK may be for either transmission, so no sample is taken and the backed-off RTO stays
+      test.execute( ExpectSRTT { 40 } );
+      test.execute( ExpectRTO { 240 } );
+
+      test.execute( Push( "def" ) );
+      test.execute( ExpectMessage {}.with_data( "def" ).with_seqno( isn + 4 ) );
+      test.execute( Tick { 60 } );
+      test.execute( AckReceived { Wrap32 { isn + 7 } }.with_win( 1000 ) );
+      // SRTT = 7/8 * 40 + 1/8 * 60, RTTVAR = 3/4 * 20 + 1/4 * |40 - 60|
+      test.execute( ExpectSRTT { 42 } );
+      test.execute( ExpectRTO { 122 } );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.rt_timeout = 1000;
+
+      TCPSenderTestHarness test { "Adaptive RTO stays within its bounds, backoff included", cfg };
+      test.execute( EnableRTTEstimation { 200, 300 } );
+      test.execute( ExpectRTO { 300 } );
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_seqno( isn ) );
+      test.execute( Tick { 10 } );
+      test.execute( AckReceived { Wrap32 { isn + 1 } }.with_win( 1000 ) );
+      test.execute( ExpectRTO { 200 } );
+      test.execute( Push( "x" ) );
+      test.execute( ExpectMessage {}.with_data( "x" ) );
+      test.execute( Tick { 200 } );
+      test.execute( ExpectMessage {}.with_data( "x" ) );
+      test.execute( ExpectRTO { 300 } );
+      test.execute( Tick { 300 } );
+      test.execute( ExpectMessage {}.with_data( "x" ) );
+      test.execute( ExpectRTO { 300 } );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      const uint16_t rto = uniform_int_distribution<uint16_t> { 30, 10000 }( rd );
+      cfg.isn = isn;
+      cfg.rt_timeout = rto;
+
+      TCPSenderTestHarness test { "Without estimation, a new ACK restores the initial RTO", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_seqno( isn ) );
+      test.execute( Tick { rto } );
+      test.execute( ExpectMessage {}.with_syn( true ).with_seqno( isn ) );
+      test.execute( ExpectRTO { 2UL * rto } );
+      test.execute( Tick { 3 } );
+      test.execute( AckReceived { Wrap32 { isn + 1 } }.with_win( 1000 ) );
+      test.execute( ExpectRTO { rto } );
+      test.execute( ExpectSRTT { 0 } );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
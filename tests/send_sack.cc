@@ -0,0 +1,188 @@
+#include "random.hh"
+#include "sender_test_harness.hh"
+#include "tcp_peer.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+    string data;
+    for ( char c = 'a'; c < 'i'; c++ ) {
+      data += string( 1000, c );
+    }
+    const auto segment = [&]( uint32_t i ) { return data.substr( i * 1000, 1000 ); };
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+
+      TCPSenderTestHarness test { "The SYN offers SACK", cfg };
+      test.execute( EnableSACK {} );
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_sack_permitted( true ) );
+      test.execute( AckReceived { isn + 1 }.with_win( 4000 ) );
+      test.execute( Push( "abc" ) );
+      test.execute( ExpectMessage {}.with_data( "abc" ).with_sack_permitted( false ) );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+
+      TCPSenderTestHarness test { "Every hole in a window is retransmitted at once, and nothing else", cfg };
+      test.execute( EnableFastRetransmit {} );
+      test.execute( EnableSACK {} );
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ) );
+      test.execute( AckReceived { isn + 1 }.with_win( 8000 ) );
+      test.execute( Push( data ) );
+      for ( uint32_t i = 0; i < 8; i++ ) {
+        test.execute( ExpectMessage {}.with_data( segment( i ) ).with_seqno( isn + 1 + i * 1000 ) );
+      }
+
+      // segments 1, 3 and 5 are lost
+      test.execute( AckReceived { isn + 1001 }.with_win( 8000 ) );
+      test.execute( AckReceived { isn + 1001 }.with_win( 8000 ).with_sack( isn + 2001, isn + 3001 ) );
+      test.execute(
+        AckReceived { isn + 1001 }.with_win( 8000 ).with_sack( isn + 4001, isn + 5001 ).with_sack( isn + 2001,
+                                                                                                   isn + 3001 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( AckReceived { isn + 1001 }
+                      .with_win( 8000 )
+                      .with_sack( isn + 6001, isn + 7001 )
+                      .with_sack( isn + 2001, isn + 3001 )
+                      .with_sack( isn + 4001, isn + 5001 ) );
+      test.execute( ExpectMessage {}.with_data( segment( 1 ) ).with_seqno( isn + 1001 ) );
+      test.execute( ExpectMessage {}.with_data( segment( 3 ) ).with_seqno( isn + 3001 ) );
+      test.execute( ExpectMessage {}.with_data( segment( 5 ) ).with_seqno( isn + 5001 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( ExpectFastRetransmissions { 3 } );
+
+      test.execute( AckReceived { isn + 1001 }
+                      .with_win( 8000 )
+                      .with_sack( isn + 6001, isn + 8001 )
+                      .with_sack( isn + 2001, isn + 3001 )
+                      .with_sack( isn + 4001, isn + 5001 ) );
+      test.execute( ExpectNoSegment {} );
+      // partial ACKs: the holes they reach were already retransmitted
+      test.execute( AckReceived { isn + 3001 }.with_win( 8000 ).with_sack( isn + 4001, isn + 5001 ).with_sack(
+        isn + 6001, isn + 8001 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( AckReceived { isn + 5001 }.with_win( 8000 ).with_sack( isn + 6001, isn + 8001 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( AckReceived { isn + 8001 }.with_win( 8000 ) );
+      test.execute( ExpectSeqnosInFlight { 0 } );
+      test.execute( ExpectFastRetransmissions { 3 } );
+      test.execute( ExpectConsecutiveRetransmissions { 0 } );
+      test.execute( ExpectNoSegment {} );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+
+      TCPSenderTestHarness test { "A hole SACKed around during recovery is retransmitted then", cfg };
+      test.execute( EnableFastRetransmit {} );
+      test.execute( EnableSACK {} );
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ) );
+      test.execute( AckReceived { isn + 1 }.with_win( 8000 ) );
+      test.execute( Push( data ) );
+      for ( uint32_t i = 0; i < 8; i++ ) {
+        test.execute( ExpectMessage {}.with_data( segment( i ) ) );
+      }
+
+      // segments 0 and 5 are lost; the hole at 5 only shows once 6 arrives
+      for ( uint32_t i = 1; i <= 3; i++ ) {
+        test.execute( AckReceived { isn + 1 }.with_win( 8000 ).with_sack( isn + 1001, isn + 1001 + i * 1000 ) );
+      }
+      test.execute( ExpectMessage {}.with_data( segment( 0 ) ).with_seqno( isn + 1 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( AckReceived { isn + 1 }.with_win( 8000 ).with_sack( isn + 1001, isn + 5001 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute(
+        AckReceived { isn + 1 }.with_win( 8000 ).with_sack( isn + 6001, isn + 7001 ).with_sack( isn + 1001,
+                                                                                                isn + 5001 ) );
+      test.execute( ExpectMessage {}.with_data( segment( 5 ) ).with_seqno( isn + 5001 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( AckReceived { isn + 5001 }.with_win( 8000 ).with_sack( isn + 6001, isn + 8001 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( AckReceived { isn + 8001 }.with_win( 8000 ) );
+      test.execute( ExpectFastRetransmissions { 2 } );
+      test.execute( ExpectSeqnosInFlight { 0 } );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+
+      TCPSenderTestHarness test { "SACK blocks are ignored unless SACK was offered", cfg };
+      test.execute( EnableFastRetransmit {} );
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_sack_permitted( false ) );
+      test.execute( AckReceived { isn + 1 }.with_win( 4000 ) );
+      test.execute( Push( data.substr( 0, 4000 ) ) );
+      for ( uint32_t i = 0; i < 4; i++ ) {
+        test.execute( ExpectMessage {}.with_data( segment( i ) ) );
+      }
+      for ( int i = 0; i < 4; i++ ) {
+        test.execute( AckReceived { isn + 1001 }.with_win( 4000 ).with_sack( isn + 3001, isn + 4001 ) );
+      }
+      // NewReno: only the oldest segment
+      test.execute( ExpectMessage {}.with_data( segment( 1 ) ) );
+      test.execute( ExpectNoSegment {} );
+    }
+
+    {
+      // two peers: only the server offers SACK, so neither side uses it
+      TCPConfig sack;
+      sack.sack = true;
+      TCPPeer client { TCPConfig {} };
+      TCPPeer server { sack };
+      vector<TCPMessage> to_server;
+      vector<TCPMessage> to_client;
+      const auto client_transmit = [&]( TCPMessage msg ) { to_server.push_back( move( msg ) ); };
+      const auto server_transmit = [&]( TCPMessage msg ) { to_client.push_back( move( msg ) ); };
+
+      client.push( client_transmit );
+      server.receive( move( to_server.at( 0 ) ), server_transmit );
+      to_server.clear();
+      if ( to_client.size() != 1 or not to_client[0].sender.SYN or to_client[0].sender.SACK_permitted ) {
+        throw runtime_error( "the SYN-ACK should not permit SACK when the SYN didn't" );
+      }
+      client.receive( move( to_client[0] ), client_transmit );
+      to_client.clear();
+      for ( auto& msg : to_server ) {
+        server.receive( move( msg ), server_transmit );
+      }
+      to_server.clear();
+
+      // the server gets the client's second segment, but not the first
+      client.outbound_writer().push( data.substr( 0, 2000 ) );
+      client.push( client_transmit );
+      server.receive( move( to_server.at( 1 ) ), server_transmit );
+      if ( to_client.empty() or not to_client.back().receiver.sack.empty() ) {
+        throw runtime_error( "SACK blocks should only be sent if both SYNs offered SACK" );
+      }
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
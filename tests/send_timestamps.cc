@@ -0,0 +1,125 @@
+#include "random.hh"
+#include "sender_test_harness.hh"
+#include "tcp_peer.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+
+      TCPSenderTestHarness test { "No timestamps by default", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_timestamp( {} ) );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.rt_timeout = 1000;
+
+      TCPSenderTestHarness test { "Segments carry the clock, and every ACK of new data gives an RTT sample", cfg };
+      test.execute( EnableRTTEstimation { 10, 60000 } );
+      test.execute( EnableTimestamps {} );
+      test.execute( Tick { 7 } );
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_timestamp( 7 ) );
+      test.execute( Tick { 40 } );
+      test.execute( AckReceived { Wrap32 { isn + 1 } }.with_win( 1000 ).with_timestamp_echo( 7 ) );
+      test.execute( ExpectSRTT { 40 } );
+      test.execute( ExpectRTO { 120 } );
+
+      test.execute( Push( "abc" ) );
+      test.execute( ExpectMessage {}.with_data( "abc" ).with_timestamp( 47 ) );
+      test.execute( Tick { 120 } );
+      test.execute( ExpectMessage {}.with_data( "abc" ).with_timestamp( 167 ) );
+      test.execute( Tick { 30 } );
+      // the echo says which transmission is being acknowledged, so even this ACK gives a sample:
+      // SRTT = 7/8 * 40 + 1/8 * 30, RTTVAR = 3/4 * 20 + 1/4 * |40 - 30|
+      test.execute( AckReceived { Wrap32 { isn + 4 } }.with_win( 1000 ).with_timestamp_echo( 167 ) );
+      test.execute( ExpectSRTT { 38 } );
+      test.execute( ExpectRTO { 108 } );
+      test.execute( ExpectNoSegment {} );
+    }
+
+    {
+      // two peers: the second one doesn't use timestamps, so the first stops too
+      TCPConfig cfg;
+      cfg.timestamps = true;
+      TCPConfig no_timestamps;
+      TCPPeer client { cfg };
+      TCPPeer server { no_timestamps };
+      vector<TCPMessage> to_server;
+      vector<TCPMessage> to_client;
+      const auto client_transmit = [&]( TCPMessage msg ) { to_server.push_back( move( msg ) ); };
+      const auto server_transmit = [&]( TCPMessage msg ) { to_client.push_back( move( msg ) ); };
+
+      client.push( client_transmit );
+      if ( to_server.size() != 1 or not to_server[0].sender.timestamp.has_value() ) {
+        throw runtime_error( "the SYN should offer timestamps" );
+      }
+      server.receive( move( to_server[0] ), server_transmit );
+      to_server.clear();
+      if ( to_client.size() != 1 or to_client[0].sender.timestamp.has_value()
+           or to_client[0].receiver.timestamp_echo.has_value() ) {
+        throw runtime_error( "a peer that doesn't use timestamps should neither send nor echo them" );
+      }
+      client.receive( move( to_client[0] ), client_transmit );
+      client.outbound_writer().push( "hello" );
+      client.push( client_transmit );
+      for ( const auto& msg : to_server ) {
+        if ( msg.sender.timestamp.has_value() or msg.receiver.timestamp_echo.has_value() ) {
+          throw runtime_error( "timestamps should only be used if both SYNs carried one" );
+        }
+      }
+    }
+
+    {
+      // two peers that both use timestamps echo each other's
+      TCPConfig cfg;
+      cfg.timestamps = true;
+      TCPPeer client { cfg };
+      TCPPeer server { cfg };
+      vector<TCPMessage> to_server;
+      vector<TCPMessage> to_client;
+      const auto client_transmit = [&]( TCPMessage msg ) { to_server.push_back( move( msg ) ); };
+      const auto server_transmit = [&]( TCPMessage msg ) { to_client.push_back( move( msg ) ); };
+
+      client.tick( 3, client_transmit );
+      client.push( client_transmit );
+      server.tick( 1000, server_transmit );
+      server.receive( move( to_server.at( 0 ) ), server_transmit );
+      to_server.clear();
+      if ( to_client.size() != 1 or to_client[0].sender.timestamp != 1000U
+           or to_client[0].receiver.timestamp_echo != 3U ) {
+        throw runtime_error( "the SYN-ACK should carry the server's clock and echo the client's" );
+      }
+      client.tick( 20, client_transmit );
+      client.receive( move( to_client[0] ), client_transmit );
+      if ( to_server.size() != 1 or to_server[0].sender.timestamp != 23U
+           or to_server[0].receiver.timestamp_echo != 1000U ) {
+        throw runtime_error( "the ACK should carry the client's clock and echo the server's" );
+      }
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
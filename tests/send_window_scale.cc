@@ -0,0 +1,138 @@
+#include "random.hh"
+#include "sender_test_harness.hh"
+#include "tcp_peer.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+
+      TCPSenderTestHarness test { "Windows are unscaled by default", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ) );
+      test.execute( AckReceived { isn + 1 }.with_win( 1000 ) );
+      test.execute( Push( string( 3000, 'x' ) ) );
+      test.execute( ExpectMessage {}.with_payload_size( 1000 ) );
+      test.execute( ExpectNoSegment {} );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.send_capacity = 300'000;
+
+      TCPSenderTestHarness test { "A scaled window can exceed 64 KiB", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ) );
+      test.execute( AckReceived { isn + 1 }.with_win( 50000 ) );
+      test.execute( SetWindowScale { 2 } );
+      test.execute( ExpectSeqnosInFlight { 0 } );
+      test.execute( AckReceived { isn + 1 }.with_win( 50000 ) );
+      test.execute( Push( string( 250'000, 'x' ) ) );
+      test.execute( ExpectSeqnosInFlight { 200'000 } );
+    }
+
+    {
+      // a handshake between two peers, each with a 1 MB receive buffer (and the default send buffer)
+      TCPConfig cfg;
+      cfg.window_scaling = true;
+      cfg.recv_capacity = 1'000'000;
+      TCPPeer client { cfg };
+      TCPPeer server { cfg };
+      vector<TCPMessage> to_server;
+      vector<TCPMessage> to_client;
+      const auto client_transmit = [&]( TCPMessage msg ) { to_server.push_back( move( msg ) ); };
+      const auto server_transmit = [&]( TCPMessage msg ) { to_client.push_back( move( msg ) ); };
+
+      client.push( client_transmit );
+      if ( to_server.size() != 1 or to_server[0].sender.window_scale != 4
+           or to_server[0].receiver.window_size != UINT16_MAX ) {
+        throw runtime_error( "the SYN should offer a window scale of 4, with an unscaled window" );
+      }
+      server.receive( move( to_server[0] ), server_transmit );
+      to_server.clear();
+      if ( to_client.size() != 1 or to_client[0].sender.window_scale != 4
+           or to_client[0].receiver.window_size != UINT16_MAX ) {
+        throw runtime_error( "the SYN-ACK should offer a window scale of 4, with an unscaled window" );
+      }
+      client.receive( move( to_client[0] ), client_transmit );
+      to_client.clear();
+      for ( auto& msg : to_server ) {
+        if ( msg.receiver.window_size != 1'000'000 >> 4 ) {
+          throw runtime_error( "the client's window should be scaled after the handshake" );
+        }
+        server.receive( move( msg ), server_transmit );
+      }
+      to_server.clear();
+
+      // until the server's first scaled ACK arrives, the client's send buffer holds what is in flight
+      const string data( 500'000, 'x' );
+      client.outbound_writer().push( data );
+      client.push( client_transmit );
+      if ( client.sender().sequence_numbers_in_flight() != TCPConfig::DEFAULT_CAPACITY ) {
+        throw runtime_error( "the send buffer should start at send_capacity" );
+      }
+      for ( auto& msg : to_server ) {
+        server.receive( move( msg ), server_transmit );
+      }
+      to_server.clear();
+      for ( auto& msg : to_client ) {
+        client.receive( move( msg ), client_transmit );
+      }
+
+      // then it grows to twice the scaled window
+      if ( client.outbound_writer().available_capacity() < 1'000'000 ) {
+        throw runtime_error( "the send buffer should grow with the server's window" );
+      }
+      client.outbound_writer().push( data );
+      client.push( client_transmit );
+      if ( client.sender().sequence_numbers_in_flight() <= UINT16_MAX ) {
+        throw runtime_error( "the client should use the server's window beyond 64 KiB" );
+      }
+    }
+
+    {
+      // a SYN-ACK offers no window scale to a peer whose SYN didn't
+      TCPConfig scaling;
+      scaling.window_scaling = true;
+      scaling.recv_capacity = 1'000'000;
+      TCPPeer client { TCPConfig {} };
+      TCPPeer server { scaling };
+      vector<TCPMessage> to_server;
+      vector<TCPMessage> to_client;
+      const auto client_transmit = [&]( TCPMessage msg ) { to_server.push_back( move( msg ) ); };
+      const auto server_transmit = [&]( TCPMessage msg ) { to_client.push_back( move( msg ) ); };
+
+      client.push( client_transmit );
+      if ( to_server.size() != 1 or to_server[0].sender.window_scale.has_value() ) {
+        throw runtime_error( "without window scaling, the SYN should not offer a window scale" );
+      }
+      server.receive( move( to_server[0] ), server_transmit );
+      if ( to_client.size() != 1 or not to_client[0].sender.SYN
+           or to_client[0].sender.window_scale.has_value() ) {
+        throw runtime_error( "the SYN-ACK should not offer a window scale the SYN didn't" );
+      }
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -1,12 +1,15 @@
 #pragma once
 
 #include "common.hh"
+#include "congestion_control.hh"
 #include "tcp_config.hh"
 #include "tcp_receiver_message.hh"
 #include "tcp_segment.hh"
 #include "tcp_sender.hh"
 #include "wrapping_integers.hh"
 
+#include <functional>
+#include <memory>
 #include <optional>
 #include <queue>
 #include <sstream>
@@ -80,6 +83,34 @@ struct ExpectConsecutiveRetransmissions : public ExpectNumber<SenderAndOutput, u
   uint64_t value( SenderAndOutput& ss ) const override { return ss.sender.consecutive_retransmissions(); }
 };
 
+struct ExpectRTO : public ExpectNumber<SenderAndOutput, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "rtt_estimate().rto_ms"; }
+  uint64_t value( SenderAndOutput& ss ) const override { return ss.sender.rtt_estimate().rto_ms; }
+};
+
+struct ExpectSRTT : public ExpectNumber<SenderAndOutput, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "rtt_estimate().srtt_ms"; }
+  uint64_t value( SenderAndOutput& ss ) const override { return ss.sender.rtt_estimate().srtt_ms; }
+};
+
+struct ExpectFastRetransmissions : public ExpectNumber<SenderAndOutput, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "fast_retransmissions"; }
+  uint64_t value( SenderAndOutput& ss ) const override { return ss.sender.fast_retransmissions(); }
+};
+
+struct ExpectCwnd : public ExpectNumber<SenderAndOutput, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "congestion_control()->cwnd()"; }
+  uint64_t value( SenderAndOutput& ss ) const override { return ss.sender.congestion_control()->cwnd(); }
+};
+
 struct ExpectNoSegment : public Expectation<SenderAndOutput>
 {
   std::string description() const override { return "nothing to send"; }
@@ -97,6 +128,77 @@ struct SetError : public Action<SenderAndOutput>
   void execute( SenderAndOutput& ss ) const override { ss.sender.writer().set_error(); }
 };
 
+struct EnableRTTEstimation : public Action<SenderAndOutput>
+{
+  uint64_t min_RTO_ms_;
+  uint64_t max_RTO_ms_;
+
+  EnableRTTEstimation( uint64_t min_RTO_ms, uint64_t max_RTO_ms )
+    : min_RTO_ms_( min_RTO_ms ), max_RTO_ms_( max_RTO_ms )
+  {}
+  std::string description() const override
+  {
+    return "enable RTT estimation with RTO in [" + std::to_string( min_RTO_ms_ ) + ", "
+           + std::to_string( max_RTO_ms_ ) + "] ms";
+  }
+  void execute( SenderAndOutput& ss ) const override
+  {
+    ss.sender.enable_rtt_estimation( min_RTO_ms_, max_RTO_ms_ );
+  }
+};
+
+struct EnableFastRetransmit : public Action<SenderAndOutput>
+{
+  std::string description() const override { return "enable fast retransmit"; }
+  void execute( SenderAndOutput& ss ) const override { ss.sender.enable_fast_retransmit(); }
+};
+
+struct EnableSACK : public Action<SenderAndOutput>
+{
+  std::string description() const override { return "enable SACK"; }
+  void execute( SenderAndOutput& ss ) const override { ss.sender.enable_sack(); }
+};
+
+struct EnableTimestamps : public Action<SenderAndOutput>
+{
+  std::string description() const override { return "enable timestamps"; }
+  void execute( SenderAndOutput& ss ) const override { ss.sender.enable_timestamps(); }
+};
+
+struct SetWindowScale : public Action<SenderAndOutput>
+{
+  uint8_t shift_;
+  explicit SetWindowScale( uint8_t shift ) : shift_( shift ) {}
+  std::string description() const override { return "set window scale to " + std::to_string( shift_ ); }
+  void execute( SenderAndOutput& ss ) const override { ss.sender.set_window_scale( shift_ ); }
+};
+
+struct SetMSS : public Action<SenderAndOutput>
+{
+  uint64_t mss_;
+  explicit SetMSS( uint64_t mss ) : mss_( mss ) {}
+  std::string description() const override { return "set MSS to " + std::to_string( mss_ ); }
+  void execute( SenderAndOutput& ss ) const override { ss.sender.set_mss( mss_ ); }
+};
+
+struct SetCongestionControl : public Action<SenderAndOutput>
+{
+  std::string name_;
+  std::function<std::unique_ptr<CongestionControl>()> make_;
+
+  explicit SetCongestionControl( CongestionControl::Algorithm algorithm )
+    : name_( algorithm == CongestionControl::Algorithm::None
+               ? "none"
+               : std::string( CongestionControl::make( algorithm, TCPConfig::MAX_PAYLOAD_SIZE )->name() ) )
+    , make_( [algorithm] { return CongestionControl::make( algorithm, TCPConfig::MAX_PAYLOAD_SIZE ); } )
+  {}
+  SetCongestionControl( std::string name, std::function<std::unique_ptr<CongestionControl>()> make )
+    : name_( std::move( name ) ), make_( std::move( make ) )
+  {}
+  std::string description() const override { return "set congestion control to " + name_; }
+  void execute( SenderAndOutput& ss ) const override { ss.sender.set_congestion_control( make_() ); }
+};
+
 struct HasError : public ExpectBool<SenderAndOutput>
 {
   using ExpectBool::ExpectBool;
@@ -187,12 +289,23 @@ struct Receive : public Action<SenderAndOutput>
 {
   TCPReceiverMessage msg_;
   bool push_ = true;
+  bool carries_data_ = false;
 
   explicit Receive( TCPReceiverMessage msg ) : msg_( msg ) {}
   std::string description() const override
   {
     std::ostringstream desc;
-    desc << "receive(ack=" << to_string( msg_.ackno ) << ", win=" << msg_.window_size << ")";
+    desc << "receive(ack=" << to_string( msg_.ackno ) << ", win=" << msg_.window_size;
+    if ( not msg_.sack.empty() ) {
+      desc << ", sack=" << to_string( msg_.sack );
+    }
+    if ( msg_.timestamp_echo.has_value() ) {
+      desc << ", tsecr=" << msg_.timestamp_echo.value();
+    }
+    desc << ")";
+    if ( carries_data_ ) {
+      desc << " with data";
+    }
     if ( push_ ) {
       desc << ", then push stream to TCPSender";
     }
@@ -207,7 +320,7 @@ struct Receive : public Action<SenderAndOutput>
 
   void execute( SenderAndOutput& ss ) const override
   {
-    ss.sender.receive( msg_ );
+    ss.sender.receive( msg_, carries_data_ );
     if ( push_ ) {
       ss.sender.push( ss.make_transmit() );
     }
@@ -218,6 +331,24 @@ struct Receive : public Action<SenderAndOutput>
     push_ = false;
     return *this;
   }
+
+  Receive& with_carried_data()
+  {
+    carries_data_ = true;
+    return *this;
+  }
+
+  Receive& with_sack( Wrap32 left, Wrap32 right )
+  {
+    msg_.sack.emplace_back( left, right );
+    return *this;
+  }
+
+  Receive& with_timestamp_echo( uint32_t echo )
+  {
+    msg_.timestamp_echo = echo;
+    return *this;
+  }
 };
 
 struct AckReceived : public Receive
@@ -235,6 +366,8 @@ struct ExpectMessage : public Expectation<SenderAndOutput>
   std::optional<bool> syn {};
   std::optional<bool> fin {};
   std::optional<bool> rst {};
+  std::optional<bool> sack_permitted {};
+  std::optional<std::optional<uint32_t>> timestamp {};
   std::optional<Wrap32> seqno {};
   std::optional<std::string> data {};
   std::optional<size_t> payload_size {};
@@ -263,6 +396,18 @@ struct ExpectMessage : public Expectation<SenderAndOutput>
     return *this;
   }
 
+  ExpectMessage& with_sack_permitted( bool sack_permitted_ )
+  {
+    sack_permitted = sack_permitted_;
+    return *this;
+  }
+
+  ExpectMessage& with_timestamp( std::optional<uint32_t> timestamp_ )
+  {
+    timestamp = timestamp_;
+    return *this;
+  }
+
   ExpectMessage& with_seqno( Wrap32 seqno_ )
   {
     seqno = seqno_;
@@ -308,6 +453,12 @@ struct ExpectMessage : public Expectation<SenderAndOutput>
     if ( rst.has_value() ) {
       o << ( rst.value() ? " +RST" : " (no RST)" );
     }
+    if ( sack_permitted.has_value() ) {
+      o << ( sack_permitted.value() ? " +SACK-permitted" : " (no SACK-permitted)" );
+    }
+    if ( timestamp.has_value() ) {
+      o << " timestamp=" << to_string( timestamp.value() );
+    }
     return o.str();
   }
 
@@ -334,13 +485,19 @@ struct ExpectMessage : public Expectation<SenderAndOutput>
     if ( rst.has_value() and seg.RST != rst.value() ) {
       throw ExpectationViolation( "RST flag", rst.value(), seg.RST );
     }
+    if ( sack_permitted.has_value() and seg.SACK_permitted != sack_permitted.value() ) {
+      throw ExpectationViolation( "SACK-permitted flag", sack_permitted.value(), seg.SACK_permitted );
+    }
+    if ( timestamp.has_value() and seg.timestamp != timestamp.value() ) {
+      throw ExpectationViolation( "timestamp", timestamp.value(), seg.timestamp );
+    }
     if ( seqno.has_value() and seg.seqno != seqno.value() ) {
       throw ExpectationViolation( "sequence number", seqno.value(), seg.seqno );
     }
     if ( payload_size.has_value() and seg.payload.size() != payload_size.value() ) {
       throw ExpectationViolation( "payload_size", payload_size.value(), seg.payload.size() );
     }
-    if ( seg.payload.size() > TCPConfig::MAX_PAYLOAD_SIZE ) {
+    if ( seg.payload.size() > ss.sender.max_payload_size() ) {
       throw ExpectationViolation( "payload has length (" + std::to_string( seg.payload.size() )
                                   + ") greater than the maximum" );
     }
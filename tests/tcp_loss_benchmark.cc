@@ -0,0 +1,294 @@
+#include "congestion_control.hh"
+#include "random.hh"
+#include "tcp_config.hh"
+#include "tcp_peer.hh"
+#include "tcp_segment.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+/*
+ * tcp_loss_benchmark: one TCPPeer sends a stream to another over a simulated link that drops each
+ * segment, in either direction, with the given probability -- the same loss model as LossyFdAdapter,
+ * which needs a TUN device -- and delays the rest by a fixed one-way latency. Time is simulated in
+ * 1 ms steps, so results don't depend on the machine. For each loss rate it reports goodput and
+ * how the lost segments were repaired: by timeouts alone, by NewReno fast retransmit, or by fast
+ * retransmit with SACK.
+ *
+ * Then it sends over a bottleneck instead: the forward link serializes segments at a fixed rate
+ * through a drop-tail queue, and each congestion control algorithm is compared on goodput,
+ * retransmissions and the queueing delay it causes. Last, a faster bottleneck whose bandwidth-delay
+ * product is more than 64 KiB shows what window scaling gains with large buffers, and what a larger
+ * MSS gains on top of that.
+ *
+ * Usage: tcp_loss_benchmark [--bytes=N] [--quick]
+ */
+
+namespace {
+constexpr uint64_t one_way_delay_ms = 10;
+constexpr uint64_t time_limit_ms = 3'600'000;
+constexpr uint64_t header_bytes = 40; // counted against the bottleneck's rate and queue
+
+struct Path
+{
+  double loss {};
+  uint64_t rate {};        // bytes per ms through the forward link's bottleneck, or 0 for no bottleneck
+  uint64_t queue_bytes {}; // how much the bottleneck's queue holds
+};
+
+struct Result
+{
+  uint64_t elapsed_ms {};
+  uint64_t segments {}; // data segments the client sent, retransmissions included
+  uint64_t retransmissions {};
+  uint64_t fast_retransmissions {};
+  double mean_queueing_ms {};
+};
+
+// A one-way link: segments come out `one_way_delay_ms` after they go in (plus their time in the
+// bottleneck, if it has one), unless dropped.
+class Link
+{
+public:
+  Link( double loss, uint64_t rate, uint64_t queue_bytes, default_random_engine& rd )
+    : loss_( loss ), rate_( rate ), queue_bytes_( queue_bytes ), rd_( rd )
+  {}
+
+  void send( TCPMessage&& msg, uint64_t now )
+  {
+    if ( bernoulli_distribution { loss_ }( rd_ ) ) {
+      return;
+    }
+    auto leaves = static_cast<double>( now );
+    if ( rate_ != 0 ) {
+      const double size = static_cast<double>( msg.sender.sequence_length() + header_bytes );
+      const double start = max( busy_until_, static_cast<double>( now ) );
+      if ( ( start - static_cast<double>( now ) ) * static_cast<double>( rate_ ) + size
+           > static_cast<double>( queue_bytes_ ) ) {
+        return; // the queue is full
+      }
+      queueing_ms_ += start - static_cast<double>( now );
+      queued_++;
+      busy_until_ = start + size / static_cast<double>( rate_ );
+      leaves = busy_until_;
+    }
+    in_flight_.emplace_back( leaves + one_way_delay_ms, move( msg ) );
+  }
+
+  double mean_queueing_ms() const { return queued_ == 0 ? 0 : queueing_ms_ / static_cast<double>( queued_ ); }
+
+  template<typename F>
+  void deliver( uint64_t now, F&& receive )
+  {
+    while ( not in_flight_.empty() and in_flight_.front().first <= static_cast<double>( now ) ) {
+      auto msg = move( in_flight_.front().second );
+      in_flight_.pop_front();
+      receive( move( msg ) );
+    }
+  }
+
+private:
+  double loss_;
+  uint64_t rate_;
+  uint64_t queue_bytes_;
+  default_random_engine& rd_;
+  double busy_until_ { 0 };
+  double queueing_ms_ { 0 };
+  uint64_t queued_ { 0 };
+  deque<pair<double, TCPMessage>> in_flight_ {};
+};
+
+// A TCPConfig with the loss recovery and options a TCP on the Internet would use (all off by default)
+TCPConfig internet_config()
+{
+  TCPConfig cfg;
+  cfg.fast_retransmit = true;
+  cfg.sack = true;
+  cfg.window_scaling = true;
+  cfg.timestamps = true;
+  return cfg;
+}
+
+Result transfer( const string& data, const Path& path, const TCPConfig& cfg, uint32_t seed )
+{
+  default_random_engine rd { seed };
+  TCPPeer client { cfg };
+  TCPPeer server { cfg };
+  Link up { path.loss, path.rate, path.queue_bytes, rd };
+  Link down { path.loss, 0, 0, rd };
+
+  Result result;
+  uint64_t now = 0;
+  uint64_t highest_sent = 0; // absolute seqno just past the furthest data the client has sent
+  const auto client_transmit = [&]( TCPMessage msg ) {
+    const uint64_t seqno = msg.sender.seqno.unwrap( cfg.isn, highest_sent );
+    if ( msg.sender.sequence_length() > 0 ) {
+      result.segments++;
+      result.retransmissions += seqno < highest_sent;
+    }
+    highest_sent = max( highest_sent, seqno + msg.sender.sequence_length() );
+    up.send( move( msg ), now );
+  };
+  const auto server_transmit = [&]( TCPMessage msg ) { down.send( move( msg ), now ); };
+
+  uint64_t written = 0;
+  uint64_t received = 0;
+  client.push( client_transmit );
+  while ( received < data.size() ) {
+    if ( now > time_limit_ms ) {
+      throw runtime_error( "transfer did not finish" );
+    }
+    up.deliver( now, [&]( TCPMessage&& msg ) { server.receive( move( msg ), server_transmit ); } );
+    down.deliver( now, [&]( TCPMessage&& msg ) { client.receive( move( msg ), client_transmit ); } );
+
+    Writer& writer = client.outbound_writer();
+    const uint64_t n = min( writer.available_capacity(), data.size() - written );
+    if ( n > 0 ) {
+      writer.push( data.substr( written, n ) );
+      written += n;
+      if ( written == data.size() ) {
+        writer.close();
+      }
+      client.push( client_transmit );
+    }
+
+    Reader& reader = server.inbound_reader();
+    while ( reader.bytes_buffered() > 0 ) {
+      const auto view = reader.peek();
+      if ( data.compare( received, view.size(), view ) != 0 ) {
+        throw runtime_error( "stream corrupted" );
+      }
+      received += view.size();
+      reader.pop( view.size() );
+    }
+
+    now++;
+    client.tick( 1, client_transmit );
+    server.tick( 1, server_transmit );
+  }
+
+  result.elapsed_ms = now;
+  result.fast_retransmissions = client.sender().fast_retransmissions();
+  result.mean_queueing_ms = up.mean_queueing_ms();
+  return result;
+}
+
+void program_body( const vector<string>& args )
+{
+  size_t bytes = 2'000'000;
+  for ( const auto& arg : args ) {
+    if ( arg.starts_with( "--bytes=" ) ) {
+      bytes = stoul( arg.substr( 8 ) );
+    } else if ( arg == "--quick" ) {
+      bytes = 200'000;
+    } else {
+      throw runtime_error( "usage: tcp_loss_benchmark [--bytes=N] [--quick]" );
+    }
+  }
+  if ( bytes == 0 ) {
+    throw runtime_error( "--bytes must be positive" );
+  }
+
+  string data( bytes, 0 );
+  auto rd = get_random_engine();
+  for ( auto& c : data ) {
+    c = static_cast<char>( rd() );
+  }
+  const uint32_t seed = rd();
+
+  cout << bytes << " bytes, " << 2 * one_way_delay_ms << " ms RTT, RTO " << TCPConfig::TIMEOUT_DFLT
+       << " ms, loss in both directions:\n";
+  cout << "  loss         recovery    seconds    Mbit/s   retransmitted   by timeout\n" << fixed;
+  for ( const double loss : { 0.0, 0.01, 0.02, 0.05 } ) {
+    for ( const string_view recovery : { "timeout", "NewReno", "SACK" } ) {
+      TCPConfig cfg;
+      cfg.fast_retransmit = recovery != "timeout";
+      cfg.sack = recovery == "SACK";
+      const Result r = transfer( data, { loss, 0, 0 }, cfg, seed );
+      const double seconds = static_cast<double>( r.elapsed_ms ) / 1000;
+      cout << "  " << setw( 3 ) << setprecision( 0 ) << loss * 100 << "%  " << setw( 15 ) << recovery << "  "
+           << setw( 9 ) << setprecision( 2 ) << seconds << "  " << setw( 8 )
+           << static_cast<double>( bytes ) * 8 / seconds / 1e6 << "  " << setw( 14 ) << r.retransmissions
+           << "  " << setw( 11 ) << r.retransmissions - r.fast_retransmissions << "\n";
+    }
+  }
+
+  // 8 Mbit/s, so a BDP of 20 kB, with a queue of one and a half BDPs; the receiver's window is larger
+  const Path bottleneck { 0, 1000, 30'000 };
+  cout << "\nover a " << bottleneck.rate * 8 / 1000 << " Mbit/s bottleneck with a " << bottleneck.queue_bytes / 1000
+       << " kB drop-tail queue:\n";
+  cout << "  congestion control    seconds    Mbit/s   retransmitted   mean queueing (ms)\n";
+  for ( const auto algorithm : { CongestionControl::Algorithm::None,
+                                 CongestionControl::Algorithm::Reno,
+                                 CongestionControl::Algorithm::CUBIC,
+                                 CongestionControl::Algorithm::BBR } ) {
+    TCPConfig cfg = internet_config();
+    cfg.congestion_control = algorithm;
+    const auto cc = CongestionControl::make( algorithm, cfg.mss );
+    const Result r = transfer( data, bottleneck, cfg, seed );
+    const double seconds = static_cast<double>( r.elapsed_ms ) / 1000;
+    cout << "  " << setw( 18 ) << ( cc ? cc->name() : "none" ) << "  " << setw( 9 ) << setprecision( 2 ) << seconds
+         << "  " << setw( 8 ) << static_cast<double>( bytes ) * 8 / seconds / 1e6 << "  " << setw( 14 )
+         << r.retransmissions << "  " << setw( 19 ) << r.mean_queueing_ms << "\n";
+  }
+
+  // 100 Mbit/s, so a BDP of 250 kB: more than an unscaled window can advertise
+  const Path fast { 0, 12'500, 250'000 };
+  constexpr size_t buffer = 1'000'000;
+  cout << "\nover a " << fast.rate * 8 / 1000 << " Mbit/s bottleneck with a " << fast.queue_bytes / 1000
+       << " kB queue, CUBIC and a " << buffer / 1000 << " kB receive buffer:\n";
+  cout << "  window scaling    seconds    Mbit/s   retransmitted\n";
+  for ( const bool scaling : { false, true } ) {
+    TCPConfig cfg = internet_config();
+    cfg.congestion_control = CongestionControl::Algorithm::CUBIC;
+    cfg.recv_capacity = buffer;
+    cfg.window_scaling = scaling;
+    const Result r = transfer( data, fast, cfg, seed );
+    const double seconds = static_cast<double>( r.elapsed_ms ) / 1000;
+    cout << "  " << setw( 14 ) << ( scaling ? "on" : "off" ) << "  " << setw( 9 ) << setprecision( 2 ) << seconds
+         << "  " << setw( 8 ) << static_cast<double>( bytes ) * 8 / seconds / 1e6 << "  " << setw( 14 )
+         << r.retransmissions << "\n";
+  }
+
+  // the same path, with the MSS of a few common MTUs: headers, checksums and system calls are paid
+  // per segment, and the congestion window grows by segments
+  cout << "\nover the same path, with BBR, window scaling and an adaptive RTO:\n";
+  cout << "  MTU     MSS    seconds    Mbit/s   segments   retransmitted\n";
+  for ( const size_t mtu : { 576, 1500, 9000 } ) {
+    TCPConfig cfg = internet_config();
+    cfg.congestion_control = CongestionControl::Algorithm::BBR;
+    cfg.recv_capacity = buffer;
+    cfg.mss = TCPConfig::mss_for_mtu( mtu );
+    cfg.adaptive_rto = true; // so that the one timeout in each run doesn't cost a whole second
+    const Result r = transfer( data, fast, cfg, seed );
+    const double seconds = static_cast<double>( r.elapsed_ms ) / 1000;
+    cout << "  " << setw( 4 ) << mtu << "  " << setw( 5 ) << cfg.mss << "  " << setw( 9 ) << setprecision( 2 )
+         << seconds << "  " << setw( 8 ) << static_cast<double>( bytes ) * 8 / seconds / 1e6 << "  " << setw( 9 )
+         << r.segments << "  " << setw( 14 ) << r.retransmissions << "\n";
+  }
+}
+} // namespace
+
+int main( int argc, char* argv[] )
+{
+  try {
+    program_body( { argv + 1, argv + argc } );
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
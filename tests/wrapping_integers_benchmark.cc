@@ -0,0 +1,130 @@
+#include "wrapping_integers.hh"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+/*
+ * wrapping_integers_benchmark: nanoseconds per seqno for the operations ACK processing does for every
+ * outstanding segment -- unwrap (one at a time and with unwrap_many) and sequence-space comparison --
+ * next to the conditional unwrap this tree used before, over a window of in-flight seqnos.
+ *
+ * Usage: wrapping_integers_benchmark [--quick]
+ */
+
+namespace {
+constexpr uint64_t two_32 = 1UL << 32;
+
+// The previous, conditional unwrap, kept for comparison.
+uint64_t conditional_unwrap( Wrap32 seqno, Wrap32 zero_point, uint64_t checkpoint )
+{
+  uint64_t offset = static_cast<uint32_t>( zero_point.distance( seqno ) );
+  offset = offset + two_32 * ( checkpoint / two_32 );
+  uint32_t dis = offset > checkpoint ? offset - checkpoint : checkpoint - offset;
+  offset = dis > offset + two_32 - checkpoint ? dis = offset + two_32 - checkpoint, offset + two_32 : offset;
+  return offset > two_32 && dis > checkpoint - offset + two_32 ? offset - two_32 : offset;
+}
+
+template<typename F>
+double time_per_item( size_t items, size_t rounds, F&& body )
+{
+  const auto start = steady_clock::now();
+  for ( size_t round = 0; round < rounds; round++ ) {
+    body();
+  }
+  const auto elapsed = duration<double, nano>( steady_clock::now() - start ).count();
+  return elapsed / static_cast<double>( items * rounds );
+}
+
+void program_body( const vector<string>& args )
+{
+  size_t rounds = 2000;
+  for ( const auto& arg : args ) {
+    if ( arg == "--quick" ) {
+      rounds = 100;
+    } else {
+      throw runtime_error( "usage: wrapping_integers_benchmark [--quick]" );
+    }
+  }
+
+  // a window of segments in flight across a wrap of the 32-bit space
+  constexpr size_t segments = 4096;
+  const Wrap32 isn { 0xfffff000 };
+  const uint64_t checkpoint = 5 * two_32;
+  default_random_engine rd { 1982 };
+  uniform_int_distribution<uint32_t> length { 1, 1460 };
+  vector<Wrap32> seqnos;
+  uint64_t next = checkpoint - 2'000'000;
+  for ( size_t i = 0; i < segments; i++ ) {
+    seqnos.push_back( Wrap32::wrap( next, isn ) );
+    next += length( rd );
+  }
+  const Wrap32 ackno = Wrap32::wrap( next, isn );
+
+  vector<uint64_t> out( segments );
+  uint64_t sink = 0;
+
+  const double conditional = time_per_item( segments, rounds, [&] {
+    for ( size_t i = 0; i < segments; i++ ) {
+      out[i] = conditional_unwrap( seqnos[i], isn, checkpoint );
+    }
+    sink += out[segments / 2];
+  } );
+  const double branch_free = time_per_item( segments, rounds, [&] {
+    for ( size_t i = 0; i < segments; i++ ) {
+      out[i] = seqnos[i].unwrap( isn, checkpoint );
+    }
+    sink += out[segments / 2];
+  } );
+  const double batched = time_per_item( segments, rounds, [&] {
+    Wrap32::unwrap_many( seqnos, isn, checkpoint, out );
+    sink += out[segments / 2];
+  } );
+  const double unwrap_compare = time_per_item( segments, rounds, [&] {
+    const uint64_t abs_ackno = ackno.unwrap( isn, checkpoint );
+    for ( size_t i = 0; i < segments; i++ ) {
+      sink += seqnos[i].unwrap( isn, checkpoint ) < abs_ackno;
+    }
+  } );
+  const double seqspace_compare = time_per_item( segments, rounds, [&] {
+    for ( size_t i = 0; i < segments; i++ ) {
+      sink += seqnos[i] < ackno;
+    }
+  } );
+
+  for ( size_t i = 0; i < segments; i++ ) {
+    if ( conditional_unwrap( seqnos[i], isn, checkpoint ) != seqnos[i].unwrap( isn, checkpoint ) ) {
+      throw runtime_error( "unwrap implementations disagree" );
+    }
+  }
+
+  cout << "Wrap32 over " << segments << " in-flight seqnos (sink " << sink % 10 << "):\n"
+       << fixed << setprecision( 2 );
+  cout << "  conditional unwrap        " << setw( 6 ) << conditional << " ns/seqno\n";
+  cout << "  branch-free unwrap        " << setw( 6 ) << branch_free << " ns/seqno\n";
+  cout << "  unwrap_many               " << setw( 6 ) << batched << " ns/seqno\n";
+  cout << "  unwrap, then compare      " << setw( 6 ) << unwrap_compare << " ns/seqno\n";
+  cout << "  sequence-space compare    " << setw( 6 ) << seqspace_compare << " ns/seqno\n";
+}
+} // namespace
+
+int main( int argc, char* argv[] )
+{
+  try {
+    program_body( { argv + 1, argv + argc } );
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,83 @@
+#include "random.hh"
+#include "test_should_be.hh"
+#include "wrapping_integers.hh"
+
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// unwrap and the comparisons are usable in constant expressions
+static_assert( Wrap32 { 5 }.unwrap( Wrap32 { 0 }, 0 ) == 5 );
+static_assert( Wrap32 { 0 }.unwrap( Wrap32 { 1 }, 10 ) == UINT32_MAX );
+static_assert( Wrap32 { 3 }.unwrap( Wrap32 { 0 }, UINT64_MAX ) == UINT64_MAX - UINT32_MAX + 3 );
+static_assert( Wrap32 { UINT32_MAX } < Wrap32 { 2 } );
+static_assert( Wrap32 { 2 } > Wrap32 { UINT32_MAX } );
+static_assert( Wrap32 { 7 } <= Wrap32 { 7 } and Wrap32 { 7 } >= Wrap32 { 7 } );
+static_assert( Wrap32 { UINT32_MAX - 1 }.distance( Wrap32 { 1 } ) == 3 );
+static_assert( Wrap32 { 1 }.distance( Wrap32 { UINT32_MAX - 1 } ) == -3 );
+
+namespace {
+// The absolute sequence number closest to `checkpoint` that wraps to `seqno`, found the slow way.
+uint64_t reference_unwrap( Wrap32 seqno, Wrap32 zero_point, uint64_t checkpoint )
+{
+  const uint64_t offset = static_cast<uint32_t>( zero_point.distance( seqno ) );
+  const uint64_t base = ( checkpoint & ~uint64_t { UINT32_MAX } ) + offset;
+  uint64_t best = base;
+  auto dist = []( uint64_t a, uint64_t b ) { return a > b ? a - b : b - a; };
+  if ( base >= ( 1UL << 32 ) and dist( base - ( 1UL << 32 ), checkpoint ) <= dist( best, checkpoint ) ) {
+    best = base - ( 1UL << 32 );
+  }
+  if ( base <= UINT64_MAX - ( 1UL << 32 )
+       and dist( base + ( 1UL << 32 ), checkpoint ) < dist( best, checkpoint ) ) {
+    best = base + ( 1UL << 32 );
+  }
+  return best;
+}
+} // namespace
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+    uniform_int_distribution<uint32_t> dist32;
+    uniform_int_distribution<uint64_t> dist64;
+
+    for ( int i = 0; i < 1'000'000; i++ ) {
+      const Wrap32 seqno { dist32( rd ) };
+      const Wrap32 zero_point { dist32( rd ) };
+      // checkpoints anywhere, and near both ends of the range
+      const uint64_t far = dist64( rd );
+      const uint64_t low = dist64( rd ) % ( 1UL << 33 );
+      const uint64_t high = UINT64_MAX - low;
+      for ( const uint64_t checkpoint : { far, low, high } ) {
+        test_should_be( seqno.unwrap( zero_point, checkpoint ), reference_unwrap( seqno, zero_point, checkpoint ) );
+      }
+
+      const auto n = static_cast<uint32_t>( dist32( rd ) % ( 1U << 31 ) );
+      test_should_be( seqno < seqno + n, n > 0 );
+      test_should_be( seqno + n <= seqno, n == 0 );
+      test_should_be( seqno.distance( seqno + n ), static_cast<int32_t>( n ) );
+    }
+
+    vector<Wrap32> seqnos;
+    for ( uint32_t i = 0; i < 1000; i++ ) {
+      seqnos.push_back( Wrap32 { UINT32_MAX - 500 + i * 7 } );
+    }
+    vector<uint64_t> out( seqnos.size() );
+    Wrap32::unwrap_many( seqnos, Wrap32 { 100 }, 1UL << 40, out );
+    for ( size_t i = 0; i < seqnos.size(); i++ ) {
+      test_should_be( out[i], seqnos[i].unwrap( Wrap32 { 100 }, 1UL << 40 ) );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -2,12 +2,32 @@
 #include "exception.hh"
 #include "socket.hh"
 
+#include <algorithm>
 #include <cstring>
+#include <deque>
 #include <iomanip>
 #include <iostream>
 
 using namespace std;
 
+namespace {
+// NOLINTBEGIN(*-avoid-non-const-global-variables)
+thread_local deque<coroutine_handle<>> ready_coroutines {};    // scheduled, to be resumed by the next drain
+thread_local deque<coroutine_handle<>> resuming_coroutines {}; // being resumed by the current drain
+// NOLINTEND(*-avoid-non-const-global-variables)
+}
+
+void EventLoop::schedule( coroutine_handle<> handle )
+{
+  ready_coroutines.push_back( handle );
+}
+
+void EventLoop::unschedule( coroutine_handle<> handle )
+{
+  erase( ready_coroutines, handle );
+  erase( resuming_coroutines, handle );
+}
+
 unsigned int EventLoop::FDRule::service_count() const
 {
   return direction == Direction::In ? fd.read_count() : fd.write_count();
@@ -82,6 +102,19 @@ void EventLoop::RuleHandle::cancel()
 // NOLINTBEGIN(*-signed-bitwise)
 EventLoop::Result EventLoop::wait_next_event( const int timeout_ms )
 {
+  // before any rule, resume the coroutines whose awaited condition became true. Only those queued
+  // now: the ones they schedule wait for the next call, so coroutines that keep waking each other
+  // can't starve the rules. Having done some work, don't block in poll below.
+  const bool resumed = not ready_coroutines.empty();
+  if ( resumed ) {
+    resuming_coroutines.swap( ready_coroutines );
+    while ( not resuming_coroutines.empty() ) {
+      const auto handle = resuming_coroutines.front();
+      resuming_coroutines.pop_front();
+      handle.resume();
+    }
+  }
+
   // first, handle the non-file-descriptor-related rules
   {
     for ( auto it = _non_fd_rules.begin(); it != _non_fd_rules.end(); ) {
@@ -154,12 +187,12 @@ EventLoop::Result EventLoop::wait_next_event( const int timeout_ms )
 
   // quit if there is nothing left to poll
   if ( not something_to_poll ) {
-    return Result::Exit;
+    return resumed ? Result::Success : Result::Exit;
   }
 
   // call poll -- wait until one of the fds satisfies one of the rules (writeable/readable)
-  if ( 0 == CheckSystemCall( "poll", ::poll( pollfds.data(), pollfds.size(), timeout_ms ) ) ) {
-    return Result::Timeout;
+  if ( 0 == CheckSystemCall( "poll", ::poll( pollfds.data(), pollfds.size(), resumed ? 0 : timeout_ms ) ) ) {
+    return resumed ? Result::Success : Result::Timeout;
   }
 
   // go through the poll results
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <coroutine>
 #include <functional>
 #include <list>
 #include <memory>
@@ -98,8 +99,17 @@ public:
     const InterestT& interest = [] { return true; } );
 
   //! Calls [poll(2)](\ref man2::poll) and then executes callback for each ready fd.
+  //! \details Coroutines queued with schedule() are resumed first; the rules are then served as usual,
+  //! but poll() doesn't wait if any coroutine was resumed.
   Result wait_next_event( int timeout_ms );
 
+  //! Queue a suspended coroutine to be resumed by the next call to wait_next_event() on this thread.
+  //! \details Used by ByteStream's awaitables; the queue is shared by every EventLoop on the thread.
+  static void schedule( std::coroutine_handle<> handle );
+
+  //! Forget a coroutine queued with schedule() (e.g. because it is being destroyed).
+  static void unschedule( std::coroutine_handle<> handle );
+
   // convenience function to add category and rule at the same time
   template<typename... Targs>
   auto add_rule( const std::string& name, Targs&&... Fargs )
@@ -151,6 +151,46 @@ void FileDescriptor::read( vector<string>& buffers )
   }
 }
 
+size_t FileDescriptor::finish_read( const ssize_t bytes_read, const size_t requested )
+{
+  if ( bytes_read < 0 ) {
+    if ( internal_fd_->non_blocking_ and ( errno == EAGAIN or errno == EINPROGRESS ) ) {
+      return 0;
+    }
+    throw unix_error { "read" };
+  }
+
+  register_read();
+
+  if ( bytes_read == 0 and requested != 0 ) {
+    internal_fd_->eof_ = true;
+  }
+
+  if ( bytes_read > static_cast<ssize_t>( requested ) ) {
+    throw runtime_error( "read() read more than requested" );
+  }
+
+  return bytes_read;
+}
+
+size_t FileDescriptor::read( span<char> buffer )
+{
+  return finish_read( ::read( fd_num(), buffer.data(), buffer.size() ), buffer.size() );
+}
+
+size_t FileDescriptor::read( span<const span<char>> buffers )
+{
+  vector<iovec> iovecs;
+  iovecs.reserve( buffers.size() );
+  size_t total_size = 0;
+  for ( const auto x : buffers ) {
+    iovecs.push_back( { x.data(), x.size() } );
+    total_size += x.size();
+  }
+
+  return finish_read( ::readv( fd_num(), iovecs.data(), static_cast<int>( iovecs.size() ) ), total_size );
+}
+
 size_t FileDescriptor::write( string_view buffer )
 {
   return write( vector<string_view> { buffer } );
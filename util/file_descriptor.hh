@@ -3,6 +3,8 @@
 #include <cstddef>
 #include <limits>
 #include <memory>
+#include <span>
+#include <string_view>
 #include <vector>
 
 // A reference-counted handle to a file descriptor
@@ -54,6 +56,9 @@ protected:
   template<typename T>
   T CheckSystemCall( std::string_view s_attempt, T return_value ) const;
 
+  // bookkeeping shared by the read() overloads that fill caller-owned memory
+  size_t finish_read( ssize_t bytes_read, size_t requested );
+
 public:
   // Construct from a file descriptor number returned by the kernel
   explicit FileDescriptor( int fd );
@@ -65,6 +70,11 @@ public:
   void read( std::string& buffer );
   void read( std::vector<std::string>& buffers );
 
+  // Read into caller-owned memory (e.g. from Writer::reserve) without allocating
+  // returns number of bytes read (0 on EOF or if a non-blocking fd has nothing to read)
+  size_t read( std::span<char> buffer );
+  size_t read( std::span<const std::span<char>> buffers );
+
   // Attempt to write a buffer
   // returns number of bytes written
   size_t write( std::string_view buffer );
@@ -0,0 +1,100 @@
+#include "mirrored_buffer.hh"
+
+#include "exception.hh"
+#include "file_descriptor.hh"
+
+#include <cstring>
+#include <iostream>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <utility>
+
+using namespace std;
+
+namespace {
+char* check_mmap( const string_view s_attempt, void* const result )
+{
+  if ( result == MAP_FAILED ) {
+    throw unix_error { s_attempt };
+  }
+  return static_cast<char*>( result );
+}
+} // namespace
+
+MirroredBuffer::MirroredBuffer( const size_t min_size )
+{
+  if ( min_size == 0 ) {
+    return;
+  }
+
+  const auto page_size
+    = static_cast<size_t>( CheckSystemCall( "sysconf", static_cast<int>( sysconf( _SC_PAGESIZE ) ) ) );
+  const size_t size = ( min_size + page_size - 1 ) / page_size * page_size;
+
+  // The backing memory: an anonymous file that both mappings will share.
+  FileDescriptor memfd { CheckSystemCall( "memfd_create", memfd_create( "minnow-ring", MFD_CLOEXEC ) ) };
+  CheckSystemCall( "ftruncate", ftruncate( memfd.fd_num(), static_cast<off_t>( size ) ) );
+
+  // Reserve a contiguous range of twice the size, then map the file into each half.
+  char* const base = check_mmap( "mmap", mmap( nullptr, 2 * size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 ) );
+  try {
+    for ( const size_t offset : { size_t { 0 }, size } ) {
+      check_mmap( "mmap",
+                  mmap( base + offset, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, memfd.fd_num(), 0 ) );
+    }
+  } catch ( ... ) {
+    munmap( base, 2 * size );
+    throw;
+  }
+
+  base_ = base;
+  size_ = size;
+}
+
+void MirroredBuffer::unmap()
+{
+  if ( base_ ) {
+    CheckSystemCall( "munmap", munmap( base_, 2 * size_ ) );
+  }
+  base_ = nullptr;
+  size_ = 0;
+}
+
+MirroredBuffer::~MirroredBuffer()
+{
+  try {
+    unmap();
+  } catch ( const exception& e ) {
+    // don't throw an exception from the destructor
+    cerr << "Exception destructing MirroredBuffer: " << e.what() << endl;
+  }
+}
+
+MirroredBuffer::MirroredBuffer( const MirroredBuffer& other ) : MirroredBuffer( other.size_ )
+{
+  if ( size_ ) {
+    memcpy( base_, other.base_, size_ );
+  }
+}
+
+MirroredBuffer& MirroredBuffer::operator=( const MirroredBuffer& other )
+{
+  if ( this != &other ) {
+    MirroredBuffer copy { other };
+    *this = move( copy );
+  }
+  return *this;
+}
+
+MirroredBuffer::MirroredBuffer( MirroredBuffer&& other ) noexcept
+  : base_( exchange( other.base_, nullptr ) ), size_( exchange( other.size_, 0 ) )
+{}
+
+MirroredBuffer& MirroredBuffer::operator=( MirroredBuffer&& other ) noexcept
+{
+  if ( this != &other ) {
+    swap( base_, other.base_ );
+    swap( size_, other.size_ );
+  }
+  return *this;
+}
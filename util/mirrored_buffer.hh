@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+
+//! \brief A memory region that is mapped twice, back to back, in the address space.
+//! \details Byte `i` of the region is also visible at byte `i + size()`, so a ring buffer
+//! stored in it can always hand out its contents (or its free space) as one contiguous
+//! span, even when the data wraps around the end of the region.
+class MirroredBuffer
+{
+  char* base_ {};  // start of the first of the two mappings
+  size_t size_ {}; // size of one mapping (a multiple of the page size)
+
+  void unmap();
+
+public:
+  //! Construct an empty buffer with no storage
+  MirroredBuffer() = default;
+
+  //! Map at least `min_size` bytes (rounded up to a whole number of pages)
+  explicit MirroredBuffer( size_t min_size );
+
+  ~MirroredBuffer();
+
+  //! Copying creates a fresh mapping of the same size and copies its contents
+  MirroredBuffer( const MirroredBuffer& other );
+  MirroredBuffer& operator=( const MirroredBuffer& other );
+
+  MirroredBuffer( MirroredBuffer&& other ) noexcept;
+  MirroredBuffer& operator=( MirroredBuffer&& other ) noexcept;
+
+  char* data() { return base_; }
+  const char* data() const { return base_; }
+
+  //! Size of one copy of the region; `data()` is valid for `2 * size()` bytes
+  size_t size() const { return size_; }
+};
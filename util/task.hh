@@ -0,0 +1,53 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <utility>
+
+//! A coroutine that runs as soon as it is called, until its first co_await that has to wait.
+//! \details It is resumed from then on by whoever it waits on (e.g. a ByteStream awaitable, via
+//! EventLoop::schedule()). The Task owns the coroutine: destroying it destroys the coroutine,
+//! even one that is still suspended.
+class Task
+{
+public:
+  struct promise_type
+  {
+    std::exception_ptr exception {};
+
+    Task get_return_object() { return Task { std::coroutine_handle<promise_type>::from_promise( *this ) }; }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_always final_suspend() noexcept { return {}; } // keep the frame so done() can be checked
+    void return_void() {}
+    void unhandled_exception() { exception = std::current_exception(); }
+  };
+
+  Task( Task&& other ) noexcept : handle_( std::exchange( other.handle_, {} ) ) {}
+  Task& operator=( Task&& other ) noexcept
+  {
+    std::swap( handle_, other.handle_ );
+    return *this;
+  }
+  Task( const Task& other ) = delete;
+  Task& operator=( const Task& other ) = delete;
+  ~Task()
+  {
+    if ( handle_ ) {
+      handle_.destroy();
+    }
+  }
+
+  //! Has the coroutine run to completion? Rethrows an exception that escaped it.
+  bool done() const
+  {
+    if ( handle_.promise().exception ) {
+      std::rethrow_exception( handle_.promise().exception );
+    }
+    return handle_.done();
+  }
+
+private:
+  explicit Task( std::coroutine_handle<promise_type> handle ) : handle_( handle ) {}
+
+  std::coroutine_handle<promise_type> handle_;
+};
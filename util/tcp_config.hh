@@ -1,25 +1,54 @@
 #pragma once
 
 #include "address.hh"
+#include "congestion_control.hh"
 #include "wrapping_integers.hh"
 
 #include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <optional>
 
+class ReassemblyBudget;
+
 //! Config for TCP sender and receiver
 class TCPConfig
 {
 public:
   static constexpr size_t DEFAULT_CAPACITY = 64000; //!< Default capacity
   static constexpr size_t MAX_PAYLOAD_SIZE = 1000;  //!< Conservative max payload size for real Internet
+  static constexpr size_t DEFAULT_MSS = 536;        //!< MSS to assume if the peer's SYN has none (RFC 9293)
+  static constexpr size_t IPV4_TCP_HEADER_LEN = 40; //!< Fixed IPv4 and TCP headers, without options
   static constexpr uint16_t TIMEOUT_DFLT = 1000;    //!< Default re-transmit timeout is 1 second
   static constexpr unsigned MAX_RETX_ATTEMPTS = 8;  //!< Maximum re-transmit attempts before giving up
+  static constexpr uint16_t RTO_MIN_DFLT = 200;     //!< Default floor for an adaptive RTO (as in Linux)
+  static constexpr uint16_t RTO_MAX_DFLT = 60000;   //!< Default ceiling for an adaptive RTO, backoff included
 
   uint16_t rt_timeout = TIMEOUT_DFLT;      //!< Initial value of the retransmission timeout, in milliseconds
+  bool adaptive_rto = false;               //!< Estimate the RTT and adapt the RTO to it (RFC 6298)
+  uint16_t rto_min = RTO_MIN_DFLT;         //!< Lower bound on the adaptive RTO, in milliseconds
+  uint16_t rto_max = RTO_MAX_DFLT;         //!< Upper bound on the adaptive RTO, in milliseconds
+  bool fast_retransmit = false;            //!< Recover from loss on duplicate ACKs (RFC 5681, NewReno)
+  bool sack = false;                       //!< Offer SACK on our SYN; recovery then resends only holes (RFC 2018)
+  bool window_scaling = false; //!< Offer a window scale on our SYN, so recv_capacity can pass 64 KiB (RFC 7323)
+  bool timestamps = false;    //!< Offer timestamps on our SYN: an RTT sample per ACK, and PAWS (RFC 7323)
+  size_t mss = MAX_PAYLOAD_SIZE; //!< Largest segment we accept, offered on our SYN; see mss_for_mtu()
+  CongestionControl::Algorithm congestion_control = CongestionControl::Algorithm::None; //!< cwnd and pacing
   size_t recv_capacity = DEFAULT_CAPACITY; //!< Receive capacity, in bytes
-  size_t send_capacity = DEFAULT_CAPACITY; //!< Sender capacity, in bytes
+  //! Sender capacity, in bytes. Sent bytes stay in the sender's stream until they are acknowledged,
+  //! so this also bounds the bytes in flight -- unless window scaling is negotiated, in which case the
+  //! capacity grows to twice the peer's window, up to max_send_capacity.
+  size_t send_capacity = DEFAULT_CAPACITY;
+  //! Largest the sender's capacity grows to when it follows the peer's window (see send_capacity)
+  size_t max_send_capacity = 4 << 20;
   Wrap32 isn { 137 };                      //!< Default initial sequence number
+  std::shared_ptr<ReassemblyBudget> reassembly_budget {}; //!< Out-of-order memory shared with other connections
+
+  //! The MSS that fills an interface's MTU: what is left after the fixed IPv4 and TCP headers (RFC 9293)
+  static constexpr size_t mss_for_mtu( size_t mtu )
+  {
+    return mtu > IPV4_TCP_HEADER_LEN ? mtu - IPV4_TCP_HEADER_LEN : 0;
+  }
 };
 
 //! Config for classes derived from FdAdapter
@@ -128,6 +128,7 @@ public:
   {
     TCPConfig tcp_config;
     tcp_config.rt_timeout = 100;
+    tcp_config.mss = TCPConfig::mss_for_mtu( static_cast<TunFD&>( _datagram_adapter ).mtu() );
 
     FdAdapterConfig multiplexer_config;
     multiplexer_config.source = { "169.254.144.9", std::to_string( uint16_t( std::random_device()() ) ) };
@@ -16,6 +16,7 @@
 #include <utility>
 
 static constexpr size_t TCP_TICK_MS = 10;
+static constexpr size_t TCP_MAX_WRITE_VIEWS = 64; // most buffered chunks handed to one writev() call
 
 inline uint64_t timestamp_ms()
 {
@@ -105,10 +106,8 @@ void TCPMinnowSocket<AdaptT>::_initialize_TCP( const TCPConfig& config )
     _thread_data,
     Direction::In,
     [&] {
-      std::string data;
-      data.resize( _tcp->outbound_writer().available_capacity() );
-      _thread_data.read( data );
-      _tcp->outbound_writer().push( move( data ) );
+      Writer& outbound = _tcp->outbound_writer();
+      outbound.commit( _thread_data.read( outbound.reserve( outbound.available_capacity() ) ) );
 
       if ( _thread_data.eof() ) {
         _tcp->outbound_writer().close();
@@ -147,8 +146,7 @@ void TCPMinnowSocket<AdaptT>::_initialize_TCP( const TCPConfig& config )
       // the pipe, handling the possibility of a partial
       // write (i.e., only pop what was actually written).
       if ( inbound.bytes_buffered() ) {
-        const std::string_view buffer = inbound.peek();
-        const auto bytes_written = _thread_data.write( buffer );
+        const auto bytes_written = _thread_data.write( inbound.peek_views( TCP_MAX_WRITE_VIEWS ) );
         inbound.pop( bytes_written );
       }
 
@@ -7,7 +7,11 @@
 #include "tcp_sender.hh"
 #include "tcp_sender_message.hh"
 
+#include <algorithm>
+#include <cstdint>
 #include <functional>
+#include <memory>
+#include <memory_resource>
 #include <optional>
 
 class TCPPeer
@@ -18,7 +22,34 @@ class TCPPeer
   }
 
 public:
-  explicit TCPPeer( const TCPConfig& cfg ) : cfg_( cfg ) {}
+  explicit TCPPeer( const TCPConfig& cfg ) : cfg_( cfg )
+  {
+    // Both directions of the connection recycle their chunk buffers through one pool.
+    sender_.writer().set_buffer_pool( buffer_pool_ );
+    receiver_.reader().set_buffer_pool( buffer_pool_ );
+    if ( cfg_.reassembly_budget ) {
+      receiver_.set_reassembly_budget( cfg_.reassembly_budget );
+    }
+    if ( cfg_.fast_retransmit ) {
+      sender_.enable_fast_retransmit();
+    }
+    if ( cfg_.sack ) {
+      sender_.enable_sack();
+      receiver_.enable_sack();
+    }
+    if ( cfg_.window_scaling ) {
+      receiver_.enable_window_scaling();
+    }
+    if ( cfg_.timestamps ) {
+      sender_.enable_timestamps();
+      receiver_.enable_timestamps();
+    }
+    sender_.set_mss( cfg_.mss );
+    sender_.set_congestion_control( CongestionControl::make( cfg_.congestion_control, cfg_.mss ) );
+    if ( cfg_.adaptive_rto ) {
+      sender_.enable_rtt_estimation( cfg_.rto_min, cfg_.rto_max );
+    }
+  }
 
   Writer& outbound_writer() { return sender_.writer(); }
   Reader& inbound_reader() { return receiver_.reader(); }
@@ -27,10 +58,15 @@ public:
   using TransmitFunction = std::function<void( TCPMessage )>;
 
   /* Passthrough methods */
-  void push( const TransmitFunction& transmit ) { sender_.push( make_send( transmit ) ); }
+  void push( const TransmitFunction& transmit )
+  {
+    leave_room_for_sack();
+    sender_.push( make_send( transmit ) );
+  }
   void tick( uint64_t t, const TransmitFunction& transmit )
   {
     cumulative_time_ += t;
+    leave_room_for_sack();
     sender_.tick( t, make_send( transmit ) );
   }
   bool has_ackno() const { return receiver_.send().ackno.has_value(); }
@@ -70,10 +106,42 @@ public:
     }
 
     // Give incoming TCPSenderMessage to receiver.
+    const bool carries_data = msg.sender.sequence_length() > 0;
+    const bool peer_scales_window = msg.sender.SYN and msg.sender.window_scale.has_value();
+    const uint8_t peer_window_shift = msg.sender.window_scale.value_or( 0 );
+    const bool peer_timestamps = not msg.sender.SYN or msg.sender.timestamp.has_value();
+    const bool peer_sack = not msg.sender.SYN or msg.sender.SACK_permitted;
+    const bool first_syn = msg.sender.SYN and not receiver_.send().ackno.has_value();
+    const size_t peer_mss = msg.sender.mss.value_or( TCPConfig::DEFAULT_MSS );
     receiver_.receive( std::move( msg.sender ) );
 
-    // Give incoming TCPReceiverMessage to sender.
-    sender_.receive( msg.receiver );
+    // Segments are no larger than either side's MSS. The congestion window counts in segments, so
+    // it starts over with the one negotiated (only our SYN can have been sent yet).
+    if ( first_syn ) {
+      peer_offered_window_scale_ = peer_scales_window;
+      const size_t mss = std::min( cfg_.mss, peer_mss );
+      sender_.set_mss( mss );
+      sender_.set_congestion_control( CongestionControl::make( cfg_.congestion_control, mss ) );
+    }
+
+    // Give incoming TCPReceiverMessage to sender, then let it send what the ACK allows (new data, or a
+    // fast retransmission). If both SYNs offered window scaling, the peer's windows are scaled from
+    // now on (but not the one on its SYN), and the send buffer grows to keep up with them; SACK and
+    // timestamps stay on only if the peer's SYN offered them too.
+    sender_.receive( msg.receiver, carries_data );
+    if ( peer_scales_window and cfg_.window_scaling ) {
+      sender_.set_window_scale( peer_window_shift );
+      sender_.enable_send_buffer_autotuning( cfg_.max_send_capacity );
+    }
+    if ( not peer_sack ) {
+      sender_.disable_sack();
+    }
+    if ( not peer_timestamps ) {
+      sender_.disable_timestamps();
+    }
+    if ( active() ) {
+      push( transmit );
+    }
 
     // Send reply if needed.
     if ( need_send_ ) {
@@ -84,21 +152,53 @@ public:
   // Testing interface
   const TCPReceiver& receiver() const { return receiver_; }
   const TCPSender& sender() const { return sender_; }
+  const BufferPool& buffer_pool() const { return *buffer_pool_; }
 
 private:
   TCPConfig cfg_;
-  TCPSender sender_ { ByteStream { cfg_.send_capacity }, cfg_.isn, cfg_.rt_timeout };
-  TCPReceiver receiver_ { Reassembler { ByteStream { cfg_.recv_capacity } } };
+  std::shared_ptr<BufferPool> buffer_pool_ { std::make_shared<BufferPool>() };
+  // Arena for the sender's and the reassembler's bookkeeping. It is declared before them so that it
+  // outlives them, and everything in it is released at once when the connection goes away.
+  std::unique_ptr<std::pmr::unsynchronized_pool_resource> arena_ {
+    std::make_unique<std::pmr::unsynchronized_pool_resource>() };
+  TCPSender sender_ { ByteStream { cfg_.send_capacity }, cfg_.isn, cfg_.rt_timeout, arena_.get() };
+  TCPReceiver receiver_ {
+    Reassembler { ByteStream { cfg_.recv_capacity }, Reassembler::Mode::Extents, arena_.get() } };
 
   bool need_send_ {};
+  bool peer_offered_window_scale_ {}; // the peer's SYN carried a window scale
 
   void send( const TCPSenderMessage& sender_message, const TransmitFunction& transmit )
   {
     TCPMessage msg { sender_message, receiver_.send() };
+    if ( msg.sender.SYN ) {
+      // our SYN offers our MSS and window scale, and its own window is never scaled; a SYN-ACK only
+      // offers a window scale if the SYN it answers did (RFC 7323)
+      msg.sender.mss = static_cast<uint16_t>( std::min<size_t>( cfg_.mss, UINT16_MAX ) );
+      if ( not msg.receiver.ackno.has_value() or peer_offered_window_scale_ ) {
+        msg.sender.window_scale = receiver_.window_scale();
+      }
+      msg.receiver.window_size = receiver_.unscaled_window_size();
+    }
+    // A retransmission keeps the size it was first sent with, so if the SACK blocks have grown since,
+    // the oldest ones are left off: options and payload together never exceed the MSS.
+    const bool timestamps = msg.sender.timestamp.has_value() or msg.receiver.timestamp_echo.has_value();
+    const size_t room = sender_.mss() - std::min<size_t>( sender_.mss(), msg.sender.payload.size() );
+    while ( ( timestamps ? 12 : 0 ) + msg.receiver.sack_option_length( timestamps ) > room
+            and not msg.receiver.sack.empty() ) {
+      msg.receiver.sack.pop_back();
+    }
     transmit( std::move( msg ) );
     need_send_ = false;
   }
 
+  // New segments are sized to leave room for the SACK blocks the receiver has to send right now.
+  void leave_room_for_sack()
+  {
+    const TCPReceiverMessage msg = receiver_.send();
+    sender_.set_receiver_options_length( msg.sack_option_length( msg.timestamp_echo.has_value() ) );
+  }
+
   bool linger_after_streams_finish_ { true }; // one peer may need to linger to make sure all closure conditions met
   uint64_t cumulative_time_ {};
   uint64_t time_of_last_receipt_ {};
@@ -2,21 +2,36 @@
 
 #include "wrapping_integers.hh"
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
 #include <optional>
+#include <utility>
+#include <vector>
 
 /*
  * The TCPReceiverMessage structure contains the information sent from a TCP receiver to its sender.
  *
- * It contains three fields:
+ * It contains five fields:
  *
  * 1) The acknowledgment number (ackno): the *next* sequence number needed by the TCP Receiver.
  *    This is an optional field that is empty if the TCPReceiver hasn't yet received the Initial Sequence Number.
  *
  * 2) The window size. This is the number of sequence numbers that the TCP receiver is interested
  *    to receive, starting from the ackno if present. The maximum value is 65,535 (UINT16_MAX from
- *    the <cstdint> header).
+ *    the <cstdint> header). If both SYNs carried a window scale (RFC 7323), it is in units of
+ *    2^(the receiver's window scale) sequence numbers -- except on a SYN, which is never scaled.
  *
  * 3) The RST (reset) flag. If set, the stream has suffered an error and the connection should be aborted.
+ *
+ * 4) The SACK blocks (RFC 2018): [left, right) ranges of sequence numbers beyond the ackno that the
+ *    receiver already holds, so the sender only needs to retransmit the holes between them. Only sent
+ *    if the sender said, on its SYN, that it understands them. The first block contains the most
+ *    recently received segment.
+ *
+ * 5) The timestamp echo (TSecr, RFC 7323): the timestamp of the segment that most recently advanced
+ *    the ackno, so the sender can measure the round-trip time from any ACK of new data. Only sent if
+ *    both SYNs carried a timestamp.
  */
 
 struct TCPReceiverMessage
@@ -24,4 +39,18 @@ struct TCPReceiverMessage
   std::optional<Wrap32> ackno {};
   uint16_t window_size {};
   bool RST {};
+  std::vector<std::pair<Wrap32, Wrap32>> sack {};
+  std::optional<uint32_t> timestamp_echo {};
+
+  // As many SACK blocks as fit in the 40 bytes a TCP header has for options (one fewer next to timestamps)
+  static constexpr size_t MAX_SACK_BLOCKS = 4;
+  static constexpr size_t MAX_SACK_BLOCKS_WITH_TIMESTAMPS = 3;
+
+  // Bytes of options that the SACK blocks which fit take up: 8 per block, and 4 for the option's kind,
+  // its length and two NOPs of padding (0 if there are no blocks)
+  size_t sack_option_length( bool timestamps ) const
+  {
+    const size_t blocks = std::min( sack.size(), timestamps ? MAX_SACK_BLOCKS_WITH_TIMESTAMPS : MAX_SACK_BLOCKS );
+    return blocks > 0 ? 4 + blocks * 8 : 0;
+  }
 };
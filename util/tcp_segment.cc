@@ -2,12 +2,89 @@
 #include "checksum.hh"
 #include "wrapping_integers.hh"
 
+#include <algorithm>
 #include <cstddef>
 
 static constexpr uint32_t TCPHeaderMinLen = 5; // 32-bit words
 
+// TCP option kinds (RFC 9293, RFC 7323, RFC 2018)
+static constexpr uint8_t TCPOptionEnd = 0;
+static constexpr uint8_t TCPOptionNop = 1;
+static constexpr uint8_t TCPOptionMSS = 2;
+static constexpr uint8_t TCPOptionWindowScale = 3;
+static constexpr uint8_t TCPOptionSACKPermitted = 4;
+static constexpr uint8_t TCPOptionSACK = 5;
+static constexpr uint8_t TCPOptionTimestamps = 8;
+
+static constexpr uint8_t TCPMaxWindowScale = 14; // RFC 7323: a larger shift is taken to be 14
+
 using namespace std;
 
+// MSS, window scale, SACK-permitted, SACK blocks and timestamps are understood; any other option is skipped
+static void parse_options( Parser& parser, uint64_t length, TCPMessage& message )
+{
+  while ( length > 0 and not parser.has_error() ) {
+    uint8_t kind {};
+    parser.integer( kind );
+    length--;
+    if ( kind == TCPOptionEnd ) {
+      break;
+    }
+    if ( kind == TCPOptionNop ) {
+      continue;
+    }
+
+    uint8_t option_length {};
+    if ( length > 0 ) {
+      parser.integer( option_length );
+    }
+    if ( option_length < 2 or option_length - 1U > length ) {
+      parser.set_error();
+      return;
+    }
+    length -= option_length - 1U;
+    const uint64_t body = option_length - 2U;
+
+    if ( kind == TCPOptionMSS and body == 2 ) {
+      uint16_t mss {};
+      parser.integer( mss );
+      if ( message.sender.SYN and mss > 0 ) {
+        message.sender.mss = mss;
+      }
+    } else if ( kind == TCPOptionWindowScale and body == 1 ) {
+      uint8_t shift {};
+      parser.integer( shift );
+      if ( message.sender.SYN ) {
+        message.sender.window_scale = min( shift, TCPMaxWindowScale );
+      }
+    } else if ( kind == TCPOptionSACKPermitted and body == 0 ) {
+      message.sender.SACK_permitted = true;
+    } else if ( kind == TCPOptionTimestamps and body == 8 ) {
+      uint32_t value {};
+      uint32_t echo {};
+      parser.integer( value );
+      parser.integer( echo );
+      message.sender.timestamp = value;
+      if ( message.receiver.ackno.has_value() ) {
+        message.receiver.timestamp_echo = echo; // only valid with ACK
+      }
+    } else if ( kind == TCPOptionSACK and body % 8 == 0 ) {
+      for ( uint64_t i = 0; i < body; i += 8 ) {
+        uint32_t left {};
+        uint32_t right {};
+        parser.integer( left );
+        parser.integer( right );
+        message.receiver.sack.emplace_back( Wrap32 { left }, Wrap32 { right } );
+      }
+    } else {
+      parser.remove_prefix( body );
+    }
+  }
+
+  // padding after the end of the option list
+  parser.remove_prefix( length );
+}
+
 void TCPSegment::parse( Parser& parser, uint32_t datagram_layer_pseudo_checksum )
 {
   /* verify checksum */
@@ -47,11 +124,11 @@ void TCPSegment::parse( Parser& parser, uint32_t datagram_layer_pseudo_checksum
   parser.integer( udinfo.cksum );
   parser.integer( raw16 ); // urgent pointer
 
-  // skip any options or anything extra in the header
   if ( data_offset < TCPHeaderMinLen ) {
     parser.set_error();
+    return;
   }
-  parser.remove_prefix( data_offset * 4 - TCPHeaderMinLen * 4 );
+  parse_options( parser, data_offset * 4 - TCPHeaderMinLen * 4, message );
 
   parser.all_remaining( message.sender.payload );
 }
@@ -64,11 +141,22 @@ public:
 
 void TCPSegment::serialize( Serializer& serializer ) const
 {
+  // each option is preceded by NOPs so that it (and so the header) ends on a 32-bit boundary
+  const bool mss = message.sender.SYN and message.sender.mss.has_value();
+  const bool window_scale = message.sender.SYN and message.sender.window_scale.has_value();
+  const bool sack_permitted = message.sender.SYN and message.sender.SACK_permitted;
+  const bool timestamps = message.sender.timestamp.has_value() or message.receiver.timestamp_echo.has_value();
+  const size_t sack_blocks
+    = min( message.receiver.sack.size(),
+           timestamps ? TCPReceiverMessage::MAX_SACK_BLOCKS_WITH_TIMESTAMPS : TCPReceiverMessage::MAX_SACK_BLOCKS );
+  const size_t options_length = ( mss ? 4 : 0 ) + ( window_scale ? 4 : 0 ) + ( sack_permitted ? 4 : 0 )
+                                + ( timestamps ? 12 : 0 ) + message.receiver.sack_option_length( timestamps );
+
   serializer.integer( udinfo.src_port );
   serializer.integer( udinfo.dst_port );
   serializer.integer( Wrap32Serializable { message.sender.seqno }.raw_value() );
   serializer.integer( Wrap32Serializable { message.receiver.ackno.value_or( Wrap32 { 0 } ) }.raw_value() );
-  serializer.integer( uint8_t { TCPHeaderMinLen << 4 } ); // data offset
+  serializer.integer( static_cast<uint8_t>( ( TCPHeaderMinLen + options_length / 4 ) << 4 ) ); // data offset
   const bool reset = message.sender.RST or message.receiver.RST;
   const uint8_t flags = ( message.receiver.ackno.has_value() ? 0b0001'0000U : 0 ) | ( reset ? 0b0000'0100U : 0 )
                         | ( message.sender.SYN ? 0b0000'0010U : 0 ) | ( message.sender.FIN ? 0b0000'0001U : 0 );
@@ -76,6 +164,43 @@ void TCPSegment::serialize( Serializer& serializer ) const
   serializer.integer( message.receiver.window_size );
   serializer.integer( udinfo.cksum );
   serializer.integer( uint16_t { 0 } ); // urgent pointer
+
+  if ( mss ) {
+    serializer.integer( TCPOptionMSS );
+    serializer.integer( uint8_t { 4 } );
+    serializer.integer( message.sender.mss.value() );
+  }
+  if ( window_scale ) {
+    serializer.integer( TCPOptionNop );
+    serializer.integer( TCPOptionWindowScale );
+    serializer.integer( uint8_t { 3 } );
+    serializer.integer( message.sender.window_scale.value() );
+  }
+  if ( sack_permitted ) {
+    serializer.integer( TCPOptionNop );
+    serializer.integer( TCPOptionNop );
+    serializer.integer( TCPOptionSACKPermitted );
+    serializer.integer( uint8_t { 2 } );
+  }
+  if ( timestamps ) {
+    serializer.integer( TCPOptionNop );
+    serializer.integer( TCPOptionNop );
+    serializer.integer( TCPOptionTimestamps );
+    serializer.integer( uint8_t { 10 } );
+    serializer.integer( message.sender.timestamp.value_or( 0 ) );
+    serializer.integer( message.receiver.timestamp_echo.value_or( 0 ) );
+  }
+  if ( sack_blocks > 0 ) {
+    serializer.integer( TCPOptionNop );
+    serializer.integer( TCPOptionNop );
+    serializer.integer( TCPOptionSACK );
+    serializer.integer( static_cast<uint8_t>( 2 + sack_blocks * 8 ) );
+    for ( size_t i = 0; i < sack_blocks; i++ ) {
+      serializer.integer( Wrap32Serializable { message.receiver.sack[i].first }.raw_value() );
+      serializer.integer( Wrap32Serializable { message.receiver.sack[i].second }.raw_value() );
+    }
+  }
+
   serializer.buffer( message.sender.payload );
 }
 
@@ -2,12 +2,14 @@
 
 #include "wrapping_integers.hh"
 
+#include <cstdint>
+#include <optional>
 #include <string>
 
 /*
  * The TCPSenderMessage structure contains the information sent from a TCP sender to its receiver.
  *
- * It contains five fields:
+ * It contains nine fields:
  *
  * 1) The sequence number (seqno) of the beginning of the segment. If the SYN flag is set, this is the
  *    sequence number of the SYN flag. Otherwise, it's the sequence number of the beginning of the payload.
@@ -20,6 +22,19 @@
  * 4) The FIN flag. If set, the payload represents the ending of the byte stream.
  *
  * 5) The RST (reset) flag. If set, the stream has suffered an error and the connection should be aborted.
+ *
+ * 6) The SACK-permitted flag (RFC 2018). Only meaningful with SYN: the sender understands SACK blocks,
+ *    so the receiver may include them in its TCPReceiverMessages.
+ *
+ * 7) The window scale (RFC 7323). Only meaningful with SYN: the windows this side advertises will be
+ *    shifted right by this many bits, if the other side's SYN carries a window scale too.
+ *
+ * 8) The timestamp (TSval, RFC 7323): the sender's clock, in milliseconds, when the segment was sent.
+ *    Offered on the SYN, and carried by every segment once both SYNs have carried one.
+ *
+ * 9) The maximum segment size (MSS, RFC 9293). Only meaningful with SYN: the most this side will accept
+ *    in one segment beyond the fixed IP and TCP headers, so TCP options come out of it too (RFC 6691).
+ *    Without it, the other side must assume 536 bytes.
  */
 
 struct TCPSenderMessage
@@ -32,6 +47,11 @@ struct TCPSenderMessage
 
   bool RST {};
 
+  bool SACK_permitted {};
+  std::optional<uint8_t> window_scale {};
+  std::optional<uint32_t> timestamp {};
+  std::optional<uint16_t> mss {};
+
   // How many sequence numbers does this segment use?
   size_t sequence_length() const { return SYN + payload.size() + FIN; }
 };
@@ -1,5 +1,6 @@
 #include "tun.hh"
 #include "exception.hh"
+#include "socket.hh"
 
 #include <cstring>
 #include <fcntl.h>
@@ -22,7 +23,7 @@ using namespace std;
 //! as root before calling this function.
 
 TunTapFD::TunTapFD( const string& devname, const bool is_tun )
-  : FileDescriptor( ::CheckSystemCall( "open", open( CLONEDEV, O_RDWR | O_CLOEXEC ) ) )
+  : FileDescriptor( ::CheckSystemCall( "open", open( CLONEDEV, O_RDWR | O_CLOEXEC ) ) ), devname_()
 {
   struct ifreq tun_req
   {};
@@ -35,4 +36,19 @@ TunTapFD::TunTapFD( const string& devname, const bool is_tun )
   tun_req.ifr_name[IFNAMSIZ - 1] = '\0';
 
   CheckSystemCall( "ioctl", ioctl( fd_num(), TUNSETIFF, static_cast<void*>( &tun_req ) ) );
+  devname_ = static_cast<const char*>( tun_req.ifr_name );
+}
+
+//! The TUN/TAP file descriptor can't be asked about the interface, so this asks through a socket.
+size_t TunTapFD::mtu() const
+{
+  struct ifreq mtu_req
+  {};
+
+  strncpy( static_cast<char*>( mtu_req.ifr_name ), devname_.data(), IFNAMSIZ - 1 );
+  mtu_req.ifr_name[IFNAMSIZ - 1] = '\0';
+
+  const UDPSocket sock;
+  CheckSystemCall( "ioctl", ioctl( sock.fd_num(), SIOCGIFMTU, static_cast<void*>( &mtu_req ) ) );
+  return static_cast<size_t>( mtu_req.ifr_mtu );
 }